@@ -0,0 +1,103 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QAtomicInt>
+#include <QCoreApplication>
+
+/**
+ * MountBenchmark runs a file system workload against a directory,
+ * usually a mountpoint. It is meant to be moved to a worker thread
+ * (see BenchmarkWindow), run() blocks until all tests are done.
+ *
+ * The workload is a map with these (optional) keys:
+ * file_size_mb, block_size_kb: sequential write/read test file
+ * random_reads: number of random 4K reads from the test file
+ * small_files, small_file_kb: small file creation test
+ * readdir_entries, readdir_passes: directory listing test
+ *
+ * Each test produces a result map with throughput and latency percentiles,
+ * all results are collected in a map with the key "tests".
+ */
+class MountBenchmark : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    progress(const QString &text);
+
+    void
+    finished(const QVariantMap &result);
+
+public:
+
+    MountBenchmark(const QDir &dir, const QVariantMap &workload = QVariantMap());
+
+    static QVariantMap
+    defaultWorkload();
+
+    /**
+     * Formats a side-by-side table, one column per result (profile).
+     */
+    static QString
+    formatResults(const QList<QVariantMap> &results);
+
+    /**
+     * Thread-safe, may be called directly from the gui thread.
+     */
+    void
+    cancel();
+
+public slots:
+
+    void
+    run();
+
+private:
+
+    bool
+    isCanceled() const;
+
+    int
+    setting(const QString &key) const;
+
+    QVariantMap
+    runSequentialWrite(const QString &file_path);
+
+    QVariantMap
+    runSequentialRead(const QString &file_path);
+
+    QVariantMap
+    runRandomRead(const QString &file_path);
+
+    QVariantMap
+    runSmallFiles(const QDir &dir);
+
+    QVariantMap
+    runReaddir(const QDir &dir);
+
+    static QVariantMap
+    summarize(const QString &name, QVector<qint64> latencies, qint64 ops, qint64 bytes, qint64 elapsed_ns);
+
+    QDir
+    m_dir;
+
+    QVariantMap
+    m_workload;
+
+    QAtomicInt
+    m_canceled;
+
+};
+
+#endif
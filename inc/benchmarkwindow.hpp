@@ -0,0 +1,195 @@
+#ifndef BENCHMARKWINDOW_HPP
+#define BENCHMARKWINDOW_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QMessageBox>
+#include <QCloseEvent>
+#include <QThread>
+#include <QPointer>
+#include <QTimer>
+#include <QRegularExpression>
+
+#include "control.hpp"
+#include "benchmark.hpp"
+#include "mountsettings.hpp"
+
+/**
+ * BenchmarkWindow runs MountBenchmark against a mountpoint.
+ * If tuning profiles are defined, the remote is remounted once per profile
+ * (with the profile's rclone arguments) and a side-by-side comparison
+ * is printed when all profiles are done.
+ * The remote can be overridden, for example with ":memory:" or a local path,
+ * to measure the mount layer without network.
+ */
+class BenchmarkWindow : public QDialog
+{
+    Q_OBJECT
+
+signals:
+
+    /**
+     * Emitted for each mount control object created by this window,
+     * so that the main window can track its state.
+     */
+    void
+    mountCreated(MountControl *mount);
+
+public:
+
+    BenchmarkWindow(MountSettings *settings, const QString &mountpoint, QWidget *parent = 0);
+
+public slots:
+
+    /**
+     * Esc: cancels a running benchmark and closes the window
+     * once the original mount has been restored, like closeEvent().
+     */
+    void
+    reject();
+
+private slots:
+
+    void
+    closeEvent(QCloseEvent *event);
+
+    void
+    run();
+
+    void
+    cancel();
+
+    void
+    nextProfile();
+
+    void
+    mountProfile();
+
+    void
+    mountReady(const QString &mountpoint);
+
+    void
+    mountStopped(const QString &mountpoint, int rc, const QByteArray &err_output);
+
+    void
+    mountTimeout();
+
+    void
+    startWorker();
+
+    void
+    showProgress(const QString &text);
+
+    void
+    workerFinished(const QVariantMap &result);
+
+    void
+    umountFinished();
+
+    void
+    finish();
+
+    void
+    restoreMount();
+
+private:
+
+    QList<QPair<QString, QStringList>>
+    profiles() const;
+
+    void
+    saveProfiles();
+
+    QVariantMap
+    workload() const;
+
+    /**
+     * Unmounts the current profile mount without blocking,
+     * then invokes the slot next.
+     */
+    void
+    umountCurrent(const char *next);
+
+    void
+    runFinished();
+
+    void
+    print(const QString &text);
+
+    MountSettings*
+    m_settings;
+
+    QString
+    m_mountpoint;
+
+    QLineEdit
+    *m_txt_remote;
+
+    QMap<QString, QSpinBox*>
+    m_spn_workload;
+
+    QPlainTextEdit
+    *m_txt_profiles;
+
+    QPlainTextEdit
+    *m_txt_output;
+
+    QPushButton
+    *m_btn_run;
+
+    QPushButton
+    *m_btn_cancel;
+
+    QList<QPair<QString, QStringList>>
+    m_queue;
+
+    QString
+    m_cur_profile;
+
+    QStringList
+    m_cur_args;
+
+    QList<QVariantMap>
+    m_results;
+
+    QPointer<MountControl>
+    m_mount;
+
+    QPointer<MountBenchmark>
+    m_worker;
+
+    QTimer
+    m_tmr_mount;
+
+    bool
+    m_running;
+
+    bool
+    m_umounting;
+
+    bool
+    m_was_mounted;
+
+    bool
+    m_close_pending;
+
+    QByteArray
+    m_after_umount; //slot invoked by umountFinished()
+
+    QString
+    m_orig_conn;
+
+};
+
+#endif
@@ -10,6 +10,15 @@
 #include <QProcess>
 #include <QPointer>
 #include <QTimer>
+#include <QStandardPaths>
+#include <QRegularExpression>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QFile>
 
 //typedef MountControlPointer QSharedPointer<MountControl>;
 
@@ -33,9 +42,35 @@ signals:
 
 public:
 
+    /**
+     * Outcome of an unmount attempt.
+     */
+    enum UmountResult
+    {
+        UmountOk,
+        UmountBusy,
+        UmountNotMounted,
+        UmountPermissionDenied,
+        UmountFailed
+    };
+
     static QStringList
     activeMountpoints();
 
+    static QList<QPointer<MountControl>>
+    activeControls();
+
+    /**
+     * Unmounts any FUSE mount at path. If the process is privileged,
+     * umount2() is called directly, otherwise the fusermount(3) helper
+     * is used. If lazy is set, a busy mount is detached (MNT_DETACH).
+     */
+    static UmountResult
+    umountPath(const QString &path, bool lazy = true);
+
+    static QString
+    umountResultString(UmountResult result);
+
     static QPointer<MountControl>
     fromMountpoint(const QDir &mountpoint, const QString &conn = QString(), bool return_new = false);
 
@@ -50,31 +85,97 @@ public:
     void
     setConnection(QString conn);
 
+    QString
+    connection() const;
+
+    /**
+     * Path within the connection to be mounted, root if empty.
+     */
+    void
+    setRemotePath(const QString &path);
+
+    QString
+    remotePath() const;
+
+    /**
+     * Additional rclone arguments (tuning profile), used on next mount().
+     */
+    void
+    setExtraArguments(const QStringList &args);
+
+    QStringList
+    extraArguments() const;
+
+    /**
+     * Remote argument for rclone mount, for example "remote:/".
+     * On-the-fly backends like ":memory:" and local paths are used as is.
+     */
+    QString
+    remoteSpec() const;
+
     bool
     isExternallyMounted() const;
 
     bool
     isMounted() const;
 
+    /**
+     * Each mount process serves the rclone remote control API
+     * on a local port (read-only calls like vfs/stats need no auth).
+     * Returns 0 if not available (yet, the port is known once rclone
+     * has logged it).
+     */
+    int
+    rcPort() const;
+
+    /**
+     * Calls an rc method, the caller takes ownership of the reply.
+     * Returns 0 if rc is not available.
+     */
+    QNetworkReply*
+    rcCall(const QString &method, const QVariantMap &params = QVariantMap());
+
     static QString
     getRclonePath();
 
+    /**
+     * Output of the mount process goes to this file, not to a pipe,
+     * so a mount that is kept running after quitting keeps working.
+     */
+    QString
+    logFilePath() const;
+
 public slots:
 
     bool
     mount();
 
+    /**
+     * Starts unmounting without waiting for the process to finish
+     * (the fusermount helper runs in the background if not privileged),
+     * umountedSignal() will be emitted when it's done.
+     */
+    void
+    requestUmount();
+
+    /**
+     * Detaches the mount and kills the process, pending uploads are lost.
+     * Does not wait, umountedSignal() will be emitted when it's done.
+     */
     void
-    umount();
+    forceUmount();
 
     void
     discard();
 
-    bool
-    umountSystem();
+    UmountResult
+    umountSystem(bool lazy = true);
 
 private slots:
 
+    void
+    umountHelperFinished();
+
     void
     checkStateDestroyed();
 
@@ -98,6 +199,15 @@ private:
     QString
     m_r_conn;
 
+    QString
+    m_remote_path;
+
+    QStringList
+    m_extra_args;
+
+    mutable int
+    m_rc_port; //0 until read from the log
+
     bool
     m_mounted;
 
@@ -107,6 +217,47 @@ private:
     static QList<QPointer<MountControl>>&
     activeConnections();
 
+    /**
+     * Last lines of the log file (error output of the mount process).
+     */
+    QByteArray
+    readLogTail(qint64 max_size = 4096) const;
+
+    static QNetworkAccessManager*
+    networkManager();
+
+    struct UmountCapabilities
+    {
+        bool native; //umount2() permitted
+        QString fusermount; //helper program, fusermount3 preferred
+    };
+
+    static const UmountCapabilities&
+    umountCapabilities();
+
+    /**
+     * Runs the helper and waits for it (a few seconds at most),
+     * only used for mounts without a process of their own.
+     */
+    static UmountResult
+    umountHelper(const QString &program, const QString &path, bool lazy);
+
+    /**
+     * Result of a finished helper process, from its exit code and message.
+     */
+    static UmountResult
+    umountHelperResult(QProcess &proc);
+
+    /**
+     * Starts fusermount -u (-z if force) in the background,
+     * handled in umountHelperFinished().
+     */
+    void
+    startUmountHelper(bool force);
+
+    static UmountResult
+    umountResultFromErrno(int error);
+
 };
 
 #endif
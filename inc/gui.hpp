@@ -61,6 +61,9 @@ public:
     void
     setHoverFgColor(QColor color);
 
+    void
+    setTitle(QString text);
+
     void
     setSubtitle(QString text);
 
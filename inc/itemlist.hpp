@@ -0,0 +1,273 @@
+#ifndef ITEMLIST_HPP
+#define ITEMLIST_HPP
+
+#include <QDebug>
+#include <QAbstractListModel>
+#include <QStyledItemDelegate>
+#include <QListView>
+#include <QPainter>
+#include <QApplication>
+#include <QPixmap>
+#include <QMouseEvent>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+/**
+ * ItemListModel is a flat list of items identified by a key
+ * (for example the mountpoint), shown by ItemListView.
+ * Items are looked up by key in O(1), and changing an item
+ * only updates its row (dataChanged), not the whole list.
+ * The list can be filtered (fuzzy), rows are then those of matching items.
+ */
+class ItemListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+
+    enum Roles
+    {
+        KeyRole = Qt::UserRole,
+        SubtitleRole,
+        StateRole
+    };
+
+    struct Item
+    {
+        QString key;
+        QString title;
+        QString subtitle;
+        QString tooltip;
+        QString keywords; //matched by filter, not shown
+        QPixmap graph; //at the right, for example a sparkline
+        int state = 0; //see ItemDelegate::setStateColors()
+
+        bool
+        operator==(const Item &other) const;
+
+        bool
+        operator!=(const Item &other) const { return !(*this == other); }
+    };
+
+    ItemListModel(QObject *parent = 0);
+
+    int
+    rowCount(const QModelIndex &parent = QModelIndex()) const;
+
+    QVariant
+    data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    /**
+     * Replaces all items (model reset).
+     */
+    void
+    setItems(const QList<Item> &items);
+
+    /**
+     * Changes the list to items, matched by key: only rows that differ
+     * are inserted, moved, removed or changed, so views keep their
+     * scroll position and hover.
+     */
+    void
+    updateItems(const QList<Item> &items);
+
+    void
+    appendItem(const Item &item);
+
+    void
+    removeItem(const QString &key);
+
+    /**
+     * Row of item, -1 if not found.
+     */
+    int
+    row(const QString &key) const;
+
+    Item
+    item(const QString &key) const;
+
+    QString
+    key(const QModelIndex &index) const;
+
+    void
+    setTitle(const QString &key, const QString &title);
+
+    void
+    setSubtitle(const QString &key, const QString &subtitle);
+
+    void
+    setToolTip(const QString &key, const QString &tooltip);
+
+    void
+    setState(const QString &key, int state);
+
+    void
+    setGraph(const QString &key, const QPixmap &graph);
+
+    /**
+     * Shows only items that match text (fuzzy: its characters in order,
+     * in title, key or keywords, case insensitive). Empty shows all.
+     * If text extends the previous filter, only the previous matches are searched.
+     */
+    void
+    setFilter(const QString &text);
+
+    QString
+    filter() const;
+
+    /**
+     * True if the characters of query (lowercase) appear in text in order.
+     */
+    static bool
+    fuzzyMatch(const QString &text, const QString &query);
+
+private:
+
+    static QString
+    searchText(const Item &item);
+
+    void
+    rowChanged(int item_index);
+
+    void
+    rebuildIndex();
+
+    void
+    applyFilter(bool narrow);
+
+    /**
+     * Changes the shown rows (m_shown) to the current matches
+     * with row signals instead of a reset.
+     */
+    void
+    updateShown();
+
+    int
+    itemIndex(int row) const;
+
+    QList<Item>
+    m_items;
+
+    QHash<QString, int>
+    m_rows; //key => index in m_items
+
+    QVector<QString>
+    m_search; //lowercase search text per item
+
+    QString
+    m_query; //normalized filter, empty if not filtered
+
+    QVector<int>
+    m_shown; //indexes of matching items (ascending), if filtered
+
+};
+
+/**
+ * ItemDelegate paints an item like an ItemButton (raised panel,
+ * big title, subtitle, "..." for the menu), colored by item state.
+ * Colors are set once per state, hover is painted from the style option,
+ * so moving the mouse does not touch the model.
+ */
+class ItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+
+    ItemDelegate(QObject *parent = 0);
+
+    void
+    setStateColors(int state, QColor bg, QColor fg, QColor hover_bg, QColor hover_fg);
+
+    void
+    setMenuIndicator(bool enabled);
+
+    void
+    paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
+    QSize
+    sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
+    /**
+     * Size of Item::graph, scaled if needed.
+     */
+    static QSize
+    graphSize();
+
+    /**
+     * Area of the "..." indicator within an item rectangle.
+     */
+    QRect
+    menuRect(const QRect &item_rect) const;
+
+private:
+
+    struct Colors
+    {
+        QPalette pal;
+        QPalette pal_hover;
+    };
+
+    QHash<int, Colors>
+    m_colors;
+
+    QFont
+    m_fnt_title;
+
+    bool
+    m_menu_indicator;
+
+};
+
+/**
+ * ItemListView shows an ItemListModel with ItemDelegate.
+ * All items have the same size, so only visible rows are laid out and painted,
+ * which keeps long lists (hundreds of mounts) fast.
+ */
+class ItemListView : public QListView
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    itemClicked(const QString &key);
+
+    /**
+     * Context menu or "..." clicked, pos is global.
+     */
+    void
+    menuRequested(const QString &key, const QPoint &pos);
+
+public:
+
+    ItemListView(ItemListModel *model, QWidget *parent = 0);
+
+    ItemListModel*
+    itemModel() const;
+
+    ItemDelegate*
+    itemDelegate() const;
+
+protected:
+
+    void
+    mouseReleaseEvent(QMouseEvent *event);
+
+private slots:
+
+    void
+    showContextMenu(const QPoint &pos);
+
+private:
+
+    ItemListModel
+    *m_model;
+
+    ItemDelegate
+    *m_delegate;
+
+};
+
+#endif
@@ -8,5 +8,7 @@
 //#include "version.hpp"
 
 #include "mainwindow.hpp"
+#include "startupprofile.hpp"
+#include "settingsbenchmark.hpp"
 
 #endif
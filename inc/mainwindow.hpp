@@ -15,7 +15,12 @@
 #include <QScrollArea>
 #include <QCloseEvent>
 #include <QPushButton>
+#include <QLineEdit>
 #include <QPointer>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QMessageBox>
+#include <QtConcurrent>
 #include <QVBoxLayout>
 #include <QVBoxLayout>
 #include <QVBoxLayout>
@@ -23,9 +28,18 @@
 #include <QVBoxLayout>
 #include <QVBoxLayout>
 #include <QVBoxLayout>
+#include <QSet>
 
 #include "mountsettings.hpp"
 #include "settingswindow.hpp"
+#include "benchmarkwindow.hpp"
+#include "shutdown.hpp"
+#include "remoteusage.hpp"
+#include "remotehealth.hpp"
+#include "itemlist.hpp"
+#include "mountstats.hpp"
+#include "startupprofile.hpp"
+#include "notifications.hpp"
 
 class MainWindow : public QDialog
 {
@@ -40,11 +54,27 @@ public:
 
     MainWindow(QWidget *parent = 0);
 
+    /**
+     * Builds the window when it's shown for the first time.
+     */
+    void
+    setVisible(bool visible);
+
 public slots:
 
     void
     openSettings();
 
+    void
+    openBenchmark();
+
+    /**
+     * Saves settings and quits, active mounts are handled
+     * according to the shutdown policy.
+     */
+    void
+    quit();
+
 private slots:
 
     void
@@ -59,15 +89,92 @@ private slots:
     void
     changeEvent(QEvent* e);
 
+    /**
+     * Throughput is polled only while the window is shown.
+     */
     void
-    loadConnections(QList<QVariantMap> conn_list);
+    showEvent(QShowEvent *event);
+
+    void
+    hideEvent(QHideEvent *event);
+
+    /**
+     * Redraws the sparkline of mountpoint.
+     */
+    void
+    statsChanged(const QString &mountpoint);
+
+    void
+    loadConnections(QList<MountConfig> conn_list);
 
     void
     initConnections();
 
+    /**
+     * Starts work that is not needed for the tray icon (config watcher,
+     * reading rclone.conf, mount on startup), after startup.
+     */
+    void
+    startBackground();
+
+    /**
+     * Updates the list, only the rows of mounts that differ
+     * between old_list and new_list.
+     */
+    void
+    applyMountChanges(const QList<MountConfig> &old_list, const QList<MountConfig> &new_list);
+
+    void
+    configFileChanged();
+
+    void
+    reloadConfig();
+
+    void
+    configReloaded();
+
+    /**
+     * Called (once per event loop iteration) when the mount list
+     * in the settings has been changed.
+     */
+    void
+    mountListChanged();
+
+    /**
+     * Shows usage of remote in the subtitle of its items.
+     */
+    void
+    usageChanged(const QString &remote);
+
+    /**
+     * Requests usage of all remotes (cached ones are not fetched again).
+     */
+    void
+    requestUsage();
+
+    /**
+     * Mounts all mounts with auto_mount set, after probing their remotes.
+     */
+    void
+    autoMount();
+
+    /**
+     * Probe result for remote, mounts waiting for it are mounted or skipped.
+     */
+    void
+    healthChanged(const QString &remote);
+
+    /**
+     * Updates the check mark of the tray action of mountpoint.
+     */
     void
     updateTrayMenu(const QString &mountpoint);
 
+    /**
+     * Updates the mount actions in the tray menu (only those that differ).
+     * With more mounts than "tray_group_threshold", they are grouped
+     * in submenus by remote.
+     */
     void
     updateTrayMenu();
 
@@ -78,13 +185,34 @@ private slots:
     updateButton(const QString &mountpoint, int mode = -1);
 
     void
-    updateButton();
+    showMountMenu(const QString &mountpoint, const QPoint &pos);
 
+    /**
+     * Shows only matching mounts, see ItemListModel::setFilter().
+     */
     void
-    actButton(const QString &mountpoint);
+    filterMounts(const QString &text);
 
+    /**
+     * Mounts or unmounts the only mount left by the filter.
+     */
     void
-    actButton(ItemButton *button);
+    actFilterMatch();
+
+    /**
+     * Opens the window with the focus on the filter (from the tray).
+     */
+    void
+    showFilter();
+
+    /**
+     * Opens the event log (not modal), also when a tray message is clicked.
+     */
+    void
+    showEventLog();
+
+    void
+    actButton(const QString &mountpoint);
 
     void
     mount(const QString &mountpoint);
@@ -92,6 +220,9 @@ private slots:
     void
     umount(const QString &mountpoint);
 
+    void
+    watchMount(MountControl *mount);
+
     void
     switchConnection(const QString &mountpoint);
 
@@ -112,18 +243,93 @@ private:
     QSystemTrayIcon
     *m_tray_icon;
 
-    QFrame
-    *m_frm_conns;
+    NotificationAggregator
+    *m_notifications;
+
+    QPointer<EventLogWindow>
+    m_wnd_event_log;
+
+    ItemListModel
+    *m_mdl_mounts;
+
+    ItemListView
+    *m_lst_mounts;
+
+    ItemButton
+    *m_btn_empty; //placeholder
+
+    QLineEdit
+    *m_txt_filter;
 
     QPointer<QMenu>
     m_mnu_tray;
 
-    QMap<QString, QPointer<ItemButton>>
-    m_btn_map;
+    QHash<QString, QPointer<QAction>>
+    m_tray_actions; //mountpoint => action
+
+    QHash<QString, QPointer<QMenu>>
+    m_tray_groups; //remote => submenu
+
+    QStringList
+    m_tray_order; //mountpoints, as in menu
+
+    QPointer<QAction>
+    m_act_tray_end; //separator after mounts
+
+    bool
+    m_tray_grouped;
+
+    QList<MountConfig>
+    m_mount_list; //as shown
+
+    QPointer<ShutdownCoordinator>
+    m_shutdown;
+
+    SettingsKey
+    m_key_size;
+
+    SettingsKey
+    m_key_pos;
+
+    QFileSystemWatcher
+    *m_config_watcher;
+
+    QTimer
+    m_tmr_reload;
+
+    QTimer
+    m_tmr_usage;
+
+    QSet<QString>
+    m_auto_mount_pending; //mountpoints waiting for probe
+
+    QFutureWatcher<QVariantMap>
+    m_reload_watcher;
+
+    bool
+    m_reload_asking; //conflict with unsaved changes, see configReloaded()
 
     MountSettings*
     getSettings();
 
+    void
+    buildWindow();
+
+    ItemListModel::Item
+    mountItem(const MountConfig &conn_config, bool connected);
+
+    /**
+     * Clears the tray menu, leaving the fixed actions.
+     */
+    void
+    resetTrayMenu(bool grouped);
+
+    QAction*
+    createTrayAction(const QString &mountpoint);
+
+    QMenu*
+    trayGroup(const QString &remote);
+
     bool
     isConnected(const QString &mountpoint);
 
@@ -0,0 +1,111 @@
+#ifndef MOUNTCONFIG_HPP
+#define MOUNTCONFIG_HPP
+
+#include <tuple>
+#include <utility>
+
+#include <QDebug>
+#include <QCoreApplication>
+#include <QVariantMap>
+#include <QStringList>
+
+/**
+ * MountConfig is the typed form of one element of the mount list.
+ * Its fields are described once in the field table below (mountConfigFields),
+ * which generates the conversion to and from QVariantMap (JSON),
+ * validation of required fields and defaults (member initializers).
+ * Keys that are not in the table are kept in extra, so converting
+ * a config back and forth does not lose anything.
+ */
+struct MountConfig
+{
+    Q_DECLARE_TR_FUNCTIONS(MountConfig)
+
+public:
+
+    QString
+    mountpoint;
+
+    QString
+    connection;
+
+    QString
+    label;
+
+    QString
+    profile;
+
+    QString
+    remote_path; //within connection, root if empty
+
+    QString
+    id; //stable, assigned by MountSettings
+
+    bool
+    auto_mount = false; //mount on startup
+
+    QVariantMap
+    extra; //unknown keys
+
+    /**
+     * Label, connection name if no label is defined.
+     */
+    QString
+    title() const;
+
+    bool
+    isValid() const;
+
+    /**
+     * Returns list of errors, empty if valid.
+     */
+    QStringList
+    validate() const;
+
+    QVariantMap
+    toVariantMap() const;
+
+    static MountConfig
+    fromVariantMap(const QVariantMap &map);
+
+    bool
+    operator==(const MountConfig &other) const;
+
+    bool
+    operator!=(const MountConfig &other) const;
+
+    template<typename F>
+    static void
+    forEachField(F &&f);
+
+};
+
+template<typename T>
+struct MountConfigField
+{
+    const char *key;
+    T MountConfig::*member;
+    bool required;
+};
+
+/**
+ * Field table: key in config file, struct member, required.
+ */
+constexpr auto mountConfigFields = std::make_tuple(
+    MountConfigField<QString>{"mountpoint", &MountConfig::mountpoint, true},
+    MountConfigField<QString>{"connection", &MountConfig::connection, true},
+    MountConfigField<QString>{"label", &MountConfig::label, false},
+    MountConfigField<QString>{"profile", &MountConfig::profile, false},
+    MountConfigField<QString>{"remote_path", &MountConfig::remote_path, false},
+    MountConfigField<QString>{"id", &MountConfig::id, false},
+    MountConfigField<bool>{"auto_mount", &MountConfig::auto_mount, false}
+);
+
+template<typename F>
+void
+MountConfig::forEachField(F &&f)
+{
+    std::apply([&f](const auto&... field) { (f(field), ...); }, mountConfigFields);
+}
+
+#endif
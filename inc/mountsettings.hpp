@@ -4,8 +4,13 @@
 #include <cassert>
 
 #include <QDebug>
+#include <QUuid>
+#include <QSet>
+#include <QDir>
+#include <QRegularExpression>
 
 #include "settingsmanager.hpp"
+#include "mountconfig.hpp"
 
 /**
  * MountSettings is the settings manager for this application.
@@ -35,13 +40,64 @@ public:
     QList<QVariantMap>
     mountConfigList() const;
 
+    /**
+     * Typed mount list, converted once per settings revision.
+     */
+    QList<MountConfig>
+    mounts() const;
+
+    /**
+     * Typed mount config, invalid (empty) if not found.
+     * Looked up in an index by normalized mountpoint, O(1).
+     */
+    MountConfig
+    mount(const QString &mountpoint) const;
+
+    /**
+     * Mount config by id (see MountConfig::id), which does not change
+     * when the mount is edited.
+     */
+    MountConfig
+    mountById(const QString &id) const;
+
+    /**
+     * Position in mount list, -1 if not found.
+     */
+    int
+    mountIndex(const QString &mountpoint) const;
+
+    /**
+     * Batch update: replaces or adds (by mountpoint) all configs
+     * and removes the given mountpoints, in a single write.
+     * New mounts get an id, replaced mounts keep theirs.
+     * A config with a known id replaces that mount in place, so changing
+     * the mountpoint renames it (same position), unless another mount
+     * already has the new mountpoint.
+     * Invalid or conflicting configs are skipped, false is returned then.
+     */
+    bool
+    updateMounts(const QList<MountConfig> &configs, const QStringList &removed_mountpoints = QStringList());
+
+    /**
+     * Replaces the mount list, keeping ids of existing mounts, O(N).
+     * Invalid configs are skipped.
+     */
+    void
+    setMounts(const QList<MountConfig> &configs);
+
+    /**
+     * Key used in the index: "/mnt//a/" => "/mnt/a"
+     */
+    static QString
+    normalizeMountpoint(const QString &mountpoint);
+
     QVariantMap
     mountConfig(const QString &mountpoint) const;
 
-    void
+    bool
     setMountConfig(const QString &mountpoint, const QVariantMap &config);
 
-    void
+    bool
     setMountConfig(const QVariantMap &config);
 
     void
@@ -50,8 +106,52 @@ public:
     void
     setMountConfigList(const QList<QVariantMap> &config);
 
+    /**
+     * Tuning profiles (name, rclone arguments), shared with the benchmark.
+     */
+    QStringList
+    profileNames() const;
+
+    QStringList
+    profileArguments(const QString &name) const;
+
+    /**
+     * Compares two mount lists by mountpoint (normalized).
+     * changed: mountpoints found in both lists with different config.
+     */
+    static void
+    diffMountConfigList(const QList<MountConfig> &old_list, const QList<MountConfig> &new_list,
+        QStringList *added, QStringList *removed, QStringList *changed);
+
 private:
 
+    SettingsKey
+    m_key_mount_list;
+
+    mutable QList<MountConfig>
+    m_mounts_cache;
+
+    mutable quint64
+    m_mounts_cache_revision;
+
+    mutable QHash<QString, int>
+    m_mount_index; //normalized mountpoint => position
+
+    mutable QHash<QString, int>
+    m_mount_id_index; //id => position
+
+    void
+    updateIndex() const;
+
+    void
+    rebuildIndex() const;
+
+    void
+    writeMounts(const QVariantList &var_list, const QList<MountConfig> &list);
+
+    static QString
+    createMountId();
+
 };
 
 #endif
@@ -0,0 +1,153 @@
+#ifndef MOUNTSTATS_HPP
+#define MOUNTSTATS_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QPainter>
+#include <QPainterPath>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+
+#include "control.hpp"
+
+/**
+ * Throughput history of a mount, the last samples in a fixed ring buffer.
+ */
+struct MountStatsHistory
+{
+    static const int
+    capacity = 60;
+
+    QVector<float>
+    rates; //bytes per second, ring buffer
+
+    int
+    head = 0; //next write position
+
+    int
+    count = 0;
+
+    qint64
+    last_bytes = -1; //transferred bytes at last sample
+
+    qint64
+    last_ms = 0; //time of last sample
+
+    int
+    uploads = 0; //queued or in progress
+
+    int
+    revision = 0; //changed with every sample
+
+    void
+    append(float rate);
+
+    /**
+     * Sample i, 0 is the oldest.
+     */
+    float
+    at(int i) const;
+
+    float
+    max() const;
+
+    float
+    last() const;
+
+};
+
+/**
+ * MountStats samples the throughput of active mounts.
+ * Each mount process is asked for its transfer statistics (rc core/stats)
+ * and its upload queue (rc vfs/stats) in an interval, only while
+ * polling is active (the list is visible).
+ * Samples go into a small ring buffer per mount, and sparkline()
+ * renders one into a pixmap, which is cached until the next sample.
+ * statsChanged() is emitted when a mount has new samples (or none anymore).
+ */
+class MountStats : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    statsChanged(const QString &mountpoint);
+
+public:
+
+    static MountStats*
+    globalInstance();
+
+    MountStats(QObject *parent = 0);
+
+    void
+    setInterval(int interval_ms);
+
+    MountStatsHistory
+    history(const QString &mountpoint) const;
+
+    /**
+     * Sparkline of the throughput of mountpoint, with the number of pending
+     * uploads at the right. Null if there are no samples.
+     * Rendered again only when there are new samples (or size or color change).
+     */
+    QPixmap
+    sparkline(const QString &mountpoint, const QSize &size, const QColor &color);
+
+public slots:
+
+    void
+    setActive(bool active);
+
+    /**
+     * Drops the samples of mountpoint (unmounted).
+     */
+    void
+    clear(const QString &mountpoint);
+
+private slots:
+
+    void
+    poll();
+
+    void
+    coreStatsReceived();
+
+    void
+    vfsStatsReceived();
+
+private:
+
+    struct CachedPixmap
+    {
+        QPixmap pixmap;
+        int revision;
+        QSize size;
+        QColor color;
+    };
+
+    QTimer
+    m_tmr_poll;
+
+    QElapsedTimer
+    m_clock;
+
+    QHash<QString, MountStatsHistory>
+    m_history;
+
+    QHash<QString, CachedPixmap>
+    m_pixmaps;
+
+    QSet<QString>
+    m_pending; //mountpoints with a request in progress
+
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef NOTIFICATIONS_HPP
+#define NOTIFICATIONS_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QSystemTrayIcon>
+#include <QPointer>
+#include <QTimer>
+#include <QDateTime>
+#include <QHash>
+
+/**
+ * One event (mounted, unmounted, error...) in the event log.
+ */
+struct EventLogEntry
+{
+    QDateTime
+    time;
+
+    QSystemTrayIcon::MessageIcon
+    level;
+
+    QString
+    category; //short, for the summary, for example "mounted"
+
+    QString
+    title;
+
+    QString
+    message;
+
+};
+
+/**
+ * NotificationAggregator collects events and shows them in the tray,
+ * batched: events within a short delay are shown as one message
+ * ("3 mounted, 1 failed"), so many mounts changing state at once
+ * (network down, quit) don't cause a flood of messages.
+ * A single event is shown as is.
+ * All events are kept in a log (the last few hundred), for EventLogWindow.
+ */
+class NotificationAggregator : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    /**
+     * A new entry has been added to the log at index.
+     */
+    void
+    entryAdded(int index);
+
+    /**
+     * Old entries have been dropped from the start of the log.
+     */
+    void
+    entriesRemoved(int count);
+
+public:
+
+    NotificationAggregator(QSystemTrayIcon *tray_icon, QObject *parent = 0);
+
+    void
+    setDelay(int delay_ms);
+
+    void
+    setMaxEntries(int count);
+
+    QList<EventLogEntry>
+    entries() const;
+
+    EventLogEntry
+    entry(int index) const;
+
+public slots:
+
+    void
+    notify(QSystemTrayIcon::MessageIcon level, const QString &category, const QString &title, const QString &message);
+
+    /**
+     * Shows pending events now.
+     */
+    void
+    flush();
+
+private:
+
+    QPointer<QSystemTrayIcon>
+    m_tray_icon;
+
+    QTimer
+    m_tmr_flush;
+
+    QList<EventLogEntry>
+    m_entries;
+
+    QList<EventLogEntry>
+    m_pending; //not shown yet
+
+    int
+    m_max_entries;
+
+};
+
+/**
+ * EventLogWindow lists the events of a NotificationAggregator,
+ * new ones are added while it's open. It's not modal.
+ */
+class EventLogWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+
+    EventLogWindow(NotificationAggregator *notifications, QWidget *parent = 0);
+
+private slots:
+
+    void
+    entryAdded(int index);
+
+    void
+    entriesRemoved(int count);
+
+private:
+
+    QPointer<NotificationAggregator>
+    m_notifications;
+
+    QTreeWidget
+    *m_tree;
+
+    void
+    addItem(const EventLogEntry &entry);
+
+};
+
+#endif
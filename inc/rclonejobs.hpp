@@ -0,0 +1,108 @@
+#ifndef RCLONEJOBS_HPP
+#define RCLONEJOBS_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QProcess>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include "control.hpp"
+
+/**
+ * RcloneJobQueue runs short rclone commands (about, lsjson...) in the
+ * background, at most maxRunning() at a time, each with a timeout.
+ * Jobs are identified by a key (for example the remote name),
+ * a key that is already queued or running is not added again.
+ *
+ * finished() is emitted for every job with a result map:
+ * "ok", "rc", "output" (stdout), "error" (stderr or process error),
+ * "elapsed_ms" and "timed_out".
+ * A job can be limited to its first lines of output, the process is
+ * stopped once they have arrived (elapsed_ms is the time until then).
+ */
+class RcloneJobQueue : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    finished(const QString &key, const QVariantMap &result);
+
+public:
+
+    RcloneJobQueue(QObject *parent = 0);
+
+    ~RcloneJobQueue();
+
+    void
+    setMaxRunning(int count);
+
+    int
+    maxRunning() const;
+
+    void
+    setTimeout(int timeout_ms);
+
+    /**
+     * Adds a job (rclone arguments), false if key is already pending.
+     * If max_lines is set, the job is done (ok) after that many lines
+     * of output, the rest is not waited for.
+     */
+    bool
+    enqueue(const QString &key, const QStringList &args, int max_lines = 0);
+
+    bool
+    isPending(const QString &key) const;
+
+private slots:
+
+    void
+    processOutput();
+
+    void
+    processFinished();
+
+    void
+    processError(QProcess::ProcessError error);
+
+    void
+    processTimeout();
+
+private:
+
+    void
+    startNext();
+
+    void
+    finish(QProcess *proc, const QVariantMap &result);
+
+    struct Job
+    {
+        QString key;
+        QStringList args;
+        int max_lines; //0 = all output
+    };
+
+    QList<Job>
+    m_queue;
+
+    QHash<QProcess*, QString>
+    m_running; //process => key
+
+    QHash<QProcess*, QElapsedTimer>
+    m_started;
+
+    int
+    m_max_running;
+
+    int
+    m_timeout;
+
+};
+
+#endif
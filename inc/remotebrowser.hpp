@@ -0,0 +1,128 @@
+#ifndef REMOTEBROWSER_HPP
+#define REMOTEBROWSER_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QProcess>
+#include <QPointer>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "control.hpp"
+
+/**
+ * RemoteBrowser lets the user pick a directory within a remote,
+ * which is then mounted instead of the root of the remote.
+ * Directories are listed with "rclone lsjson --dirs-only", one level at a time
+ * when an item is expanded, and items are added while the listing
+ * is still running (output is parsed line by line).
+ * Finished listings are cached per remote and path for a while,
+ * so reopening the browser does not list the same directories again.
+ */
+class RemoteBrowser : public QDialog
+{
+    Q_OBJECT
+
+public:
+
+    RemoteBrowser(const QString &remote, const QString &path = "", QWidget *parent = 0);
+
+    ~RemoteBrowser();
+
+    /**
+     * Selected path within the remote, empty for the root.
+     */
+    QString
+    selectedPath() const;
+
+    /**
+     * Cached listings older than this are listed again.
+     */
+    static void
+    setCacheTimeout(int seconds);
+
+private slots:
+
+    void
+    itemExpanded(QTreeWidgetItem *item);
+
+    void
+    selectionChanged();
+
+    void
+    listingOutput();
+
+    void
+    listingFinished(int rc, QProcess::ExitStatus status);
+
+    void
+    listingError(QProcess::ProcessError error);
+
+private:
+
+    struct Listing
+    {
+        QStringList dirs;
+        QDateTime time;
+    };
+
+    static QHash<QString, Listing>&
+    cache();
+
+    static int&
+    cacheTimeout();
+
+    QTreeWidgetItem*
+    addItem(QTreeWidgetItem *parent, const QString &name);
+
+    void
+    list(QTreeWidgetItem *item);
+
+    void
+    parseLine(QProcess *proc, const QByteArray &line);
+
+    QString
+    itemPath(QTreeWidgetItem *item) const;
+
+    void
+    showSelection();
+
+    QString
+    m_remote;
+
+    QString
+    m_path; //initial selection
+
+    bool
+    m_changed; //selected by the user
+
+    bool
+    m_preselecting; //selecting m_path, not the user
+
+    QTreeWidget
+    *m_tree;
+
+    QLabel
+    *m_lbl_status;
+
+    QPushButton
+    *m_btn_ok;
+
+    QHash<QProcess*, QTreeWidgetItem*>
+    m_listings; //running, process => expanded item
+
+    QHash<QProcess*, QStringList>
+    m_listed; //names received so far
+
+};
+
+#endif
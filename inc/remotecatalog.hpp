@@ -0,0 +1,167 @@
+#ifndef REMOTECATALOG_HPP
+#define REMOTECATALOG_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QProcess>
+#include <QTextStream>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "control.hpp"
+
+/**
+ * One remote (connection) defined in rclone.conf.
+ */
+struct RemoteInfo
+{
+    QString
+    name;
+
+    QString
+    type; //backend, for example "drive", "s3", "crypt"
+
+    QVariantMap
+    options; //all other keys of the section
+
+    bool
+    isValid() const { return !name.isEmpty(); }
+
+};
+
+/**
+ * RemoteCatalog knows the remotes defined in the rclone config file.
+ * The file is read once and kept, keyed on its modification time and size.
+ * It is re-read in the background when it changes (file watcher),
+ * so any component can ask for remotes without parsing the file again.
+ *
+ * The file is parsed directly (INI). An encrypted config cannot be
+ * parsed, it is read with "rclone config dump" instead,
+ * which works if rclone can decrypt it (RCLONE_CONFIG_PASS).
+ *
+ * changed() is emitted when a (re)load has produced a different list.
+ */
+class RemoteCatalog : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    changed();
+
+public:
+
+    static RemoteCatalog*
+    globalInstance();
+
+    RemoteCatalog(QObject *parent = 0);
+
+    /**
+     * $RCLONE_CONFIG or ~/.config/rclone/rclone.conf
+     */
+    static QString
+    configPath();
+
+    /**
+     * Remote names in file order. Empty until the first (background) load
+     * has finished, which is started on first access if necessary,
+     * changed() is emitted when it's done.
+     */
+    QStringList
+    remoteNames();
+
+    QList<RemoteInfo>
+    remotes();
+
+    /**
+     * Remote by name, invalid if not defined.
+     */
+    RemoteInfo
+    remote(const QString &name);
+
+    bool
+    isLoaded() const;
+
+    /**
+     * Error of the last load, empty if ok.
+     */
+    QString
+    errorString() const;
+
+    /**
+     * Reads and parses a config file, no member is touched (worker thread).
+     * Returns a map with "ok", "error", "mtime", "size"
+     * and "remotes" (list of maps with "name", "type", "options").
+     */
+    static QVariantMap
+    readConfig(const QString &path, const QString &rclone_path);
+
+public slots:
+
+    /**
+     * Reloads in the background, unless the file is unchanged.
+     */
+    void
+    refresh();
+
+private slots:
+
+    void
+    fileChanged();
+
+    void
+    loaded();
+
+private:
+
+    static bool
+    parseIni(QIODevice *device, QList<QVariantMap> *remotes);
+
+    static bool
+    readDump(const QString &path, const QString &rclone_path, QList<QVariantMap> *remotes, QString *error);
+
+    void
+    setResult(const QVariantMap &result);
+
+    void
+    watch();
+
+    QList<RemoteInfo>
+    m_remotes;
+
+    QHash<QString, int>
+    m_index; //name => position
+
+    QString
+    m_error;
+
+    bool
+    m_loaded;
+
+    qint64
+    m_mtime;
+
+    qint64
+    m_size;
+
+    QFileSystemWatcher
+    *m_watcher;
+
+    QTimer
+    m_tmr_reload;
+
+    QFutureWatcher<QVariantMap>
+    m_load_watcher;
+
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef REMOTEHEALTH_HPP
+#define REMOTEHEALTH_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "rclonejobs.hpp"
+
+/**
+ * Result of a reachability probe of a remote.
+ */
+struct RemoteHealthInfo
+{
+    enum Status
+    {
+        Unknown, //not probed yet
+        Ok,
+        Timeout,
+        AuthError, //credentials or token rejected
+        NotFound, //bucket or path missing
+        NetworkError, //host not reachable
+        ConfigError, //remote not defined or misconfigured
+        OtherError
+    };
+
+    Status
+    status = Unknown;
+
+    qint64
+    latency_ms = -1;
+
+    QString
+    error; //last line of rclone output
+
+    QDateTime
+    time; //when probed, invalid if never
+
+    bool
+    isFailing() const { return status != Unknown && status != Ok; }
+
+    /**
+     * Short text, for example "ok, 120 ms" or "authentication failed".
+     */
+    QString
+    summary() const;
+
+};
+
+/**
+ * RemoteHealth checks whether remotes work, before they are mounted.
+ * A probe lists the top level of the remote ("rclone lsjson --max-depth 1"),
+ * which needs working credentials and network, and stops at the first
+ * entry, so the latency is the time to the first answer of the remote.
+ * Remotes are probed in parallel (bounded, see RcloneJobQueue),
+ * each probe has a timeout, and results are cached for a while.
+ * Errors are classified from rclone's error output.
+ * healthChanged() is emitted when a probe has finished.
+ */
+class RemoteHealth : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    healthChanged(const QString &remote);
+
+public:
+
+    static RemoteHealth*
+    globalInstance();
+
+    RemoteHealth(QObject *parent = 0);
+
+    void
+    setTimeToLive(int seconds);
+
+    void
+    setMaxRunning(int count);
+
+    void
+    setTimeout(int timeout_ms);
+
+    /**
+     * Cached result, Unknown if never probed.
+     */
+    RemoteHealthInfo
+    health(const QString &remote) const;
+
+    /**
+     * True if a probe is queued or running for remote.
+     */
+    bool
+    isProbing(const QString &remote) const;
+
+    static RemoteHealthInfo::Status
+    classifyError(const QString &error_output);
+
+    /**
+     * True if output is the (start of a) lsjson listing:
+     * "[" followed by an entry object or the closing "]".
+     */
+    static bool
+    isListing(const QByteArray &output);
+
+public slots:
+
+    /**
+     * Probes in the background unless the cached result is recent.
+     * Returns false if nothing has been started (cached or not a named remote).
+     */
+    bool
+    probe(const QString &remote, bool force = false);
+
+    void
+    probe(const QStringList &remotes, bool force = false);
+
+private slots:
+
+    void
+    jobFinished(const QString &key, const QVariantMap &result);
+
+private:
+
+    RcloneJobQueue
+    m_jobs;
+
+    QHash<QString, RemoteHealthInfo>
+    m_cache;
+
+    int
+    m_ttl;
+
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef REMOTEUSAGE_HPP
+#define REMOTEUSAGE_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QDateTime>
+#include <QLocale>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "rclonejobs.hpp"
+
+/**
+ * Space usage of a remote, -1 where the backend does not report a value.
+ */
+struct RemoteUsageInfo
+{
+    qint64
+    total = -1;
+
+    qint64
+    used = -1;
+
+    qint64
+    free = -1;
+
+    qint64
+    objects = -1;
+
+    QString
+    error;
+
+    QDateTime
+    time; //when fetched, invalid if never
+
+    bool
+    isValid() const { return time.isValid() && error.isEmpty(); }
+
+    /**
+     * Short text for a subtitle, for example "1.2 GiB of 15 GiB used".
+     */
+    QString
+    summary() const;
+
+};
+
+/**
+ * RemoteUsage fetches space usage of remotes with "rclone about --json",
+ * instead of statfs on the mountpoint, which may block (FUSE).
+ * Requests run in the background, several remotes in parallel
+ * (see RcloneJobQueue), and results are kept for a while (time to live),
+ * so repeated requests for the same remote are answered from the cache.
+ * usageChanged() is emitted when new data for a remote has arrived.
+ */
+class RemoteUsage : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    usageChanged(const QString &remote);
+
+public:
+
+    static RemoteUsage*
+    globalInstance();
+
+    RemoteUsage(QObject *parent = 0);
+
+    void
+    setTimeToLive(int seconds);
+
+    void
+    setMaxRunning(int count);
+
+    /**
+     * Cached usage, possibly outdated or invalid (never fetched).
+     */
+    RemoteUsageInfo
+    usage(const QString &remote) const;
+
+public slots:
+
+    /**
+     * Fetches usage in the background unless the cached data is recent.
+     * Only named remotes from rclone.conf are supported.
+     */
+    void
+    request(const QString &remote, bool force = false);
+
+private slots:
+
+    void
+    jobFinished(const QString &key, const QVariantMap &result);
+
+private:
+
+    RcloneJobQueue
+    m_jobs;
+
+    QHash<QString, RemoteUsageInfo>
+    m_cache;
+
+    int
+    m_ttl;
+
+};
+
+#endif
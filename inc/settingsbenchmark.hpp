@@ -0,0 +1,41 @@
+#ifndef SETTINGSBENCHMARK_HPP
+#define SETTINGSBENCHMARK_HPP
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborValue>
+
+#include "settingsmanager.hpp"
+
+/**
+ * SettingsBenchmark measures nested key access in SettingsManager
+ * against a large config (--bench-settings on the command line).
+ * A map with one sub-map per entry is created in memory (nothing is saved),
+ * then random entries are read and written through variant()/setVariant().
+ * For comparison, the copy-and-replace write pattern
+ * (read the whole map, modify it, write it back) is timed as well,
+ * and loading the whole map from JSON and from the CBOR snapshot.
+ */
+class SettingsBenchmark
+{
+
+public:
+
+    /**
+     * Runs all tests and prints the results, returns the exit code.
+     */
+    static int
+    run(int entries = 10000, int iterations = 100000);
+
+private:
+
+    static void
+    print(const QString &test, int count, qint64 nsecs);
+
+};
+
+#endif
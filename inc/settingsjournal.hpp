@@ -0,0 +1,117 @@
+#ifndef SETTINGSJOURNAL_HPP
+#define SETTINGSJOURNAL_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QCoreApplication>
+
+#include "mountsettings.hpp"
+
+/**
+ * SettingsJournal records edits of the mount list as typed operations,
+ * instead of modifying a copy of the whole settings document.
+ * The current (edited) mount list is the live list with all operations
+ * replayed on top of it, so undo/redo only move operations between stacks.
+ *
+ * commit() validates all operations against the live settings first
+ * and only then applies them as a delta (only affected mounts are written),
+ * so either all operations are applied or none.
+ */
+class SettingsJournal
+{
+    Q_DECLARE_TR_FUNCTIONS(SettingsJournal)
+
+public:
+
+    enum Operation
+    {
+        AddMount,
+        SetLabel,
+        RemoveMount,
+        SetProfile,
+        SetRemotePath,
+        SetAutoMount
+    };
+
+    struct Entry
+    {
+        Operation op;
+        QString mountpoint;
+        QVariant value; //config (AddMount) or new field value
+    };
+
+    void
+    addMount(const MountConfig &config);
+
+    void
+    setLabel(const QString &mountpoint, const QString &label);
+
+    void
+    removeMount(const QString &mountpoint);
+
+    void
+    setProfile(const QString &mountpoint, const QString &profile);
+
+    void
+    setRemotePath(const QString &mountpoint, const QString &path);
+
+    void
+    setAutoMount(const QString &mountpoint, bool enabled);
+
+    bool
+    isEmpty() const;
+
+    bool
+    canUndo() const;
+
+    bool
+    canRedo() const;
+
+    void
+    undo();
+
+    void
+    redo();
+
+    void
+    clear();
+
+    /**
+     * Returns list with all recorded operations applied.
+     * If errors is set, operations that cannot be applied are listed.
+     */
+    QList<MountConfig>
+    apply(QList<MountConfig> list, QStringList *errors = 0) const;
+
+    /**
+     * Mountpoints touched by recorded operations.
+     */
+    QStringList
+    affectedMountpoints() const;
+
+    /**
+     * Applies all operations to settings and saves them.
+     * Returns false (and changes nothing) if any operation conflicts
+     * with the live settings, an edited mount is invalid
+     * (see MountConfig::validate()) or the config file cannot be written.
+     * A failed save rolls the settings back to the document (and dirty flag)
+     * from before the commit, the journal is only cleared after a successful save.
+     */
+    bool
+    commit(MountSettings *settings, QString *error = 0);
+
+private:
+
+    void
+    record(Operation op, const QString &mountpoint, const QVariant &value);
+
+    QList<Entry>
+    m_done;
+
+    QList<Entry>
+    m_undone;
+
+};
+
+#endif
@@ -11,6 +11,109 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QObject>
+#include <QHash>
+#include <QSaveFile>
+#include <QTimer>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QPointer>
+
+#include "settingsnotifier.hpp"
+
+/**
+ * SettingsKey is a compiled key path, returned by SettingsManager::compileKey().
+ * It can be kept and reused by the caller to skip parsing the key string
+ * (splitting, group and prefix lookups) on every access.
+ * A key compiled for another group or prefix state is recompiled on use.
+ */
+class SettingsKey
+{
+
+public:
+
+    SettingsKey();
+
+    bool
+    isValid() const;
+
+    QString
+    key() const;
+
+private:
+
+    friend class SettingsManager;
+
+    QString
+    m_key;
+
+    QStringList
+    m_dict_keys;
+
+    QString
+    m_item_key;
+
+    quint64
+    m_serial; //state of manager the key was compiled for
+
+};
+
+class SettingsDocumentData : public QSharedData
+{
+
+public:
+
+    SettingsDocumentData();
+
+    QVariantMap
+    map;
+
+    quint64
+    revision;
+
+};
+
+/**
+ * SettingsDocument is the data tree of a settings object.
+ * It is implicitly shared (copy-on-write): copies cost O(1) and share
+ * the tree until one of them is modified through map().
+ * Every modification assigns a new, globally unique revision,
+ * so two documents with the same revision have the same contents.
+ */
+class SettingsDocument
+{
+
+public:
+
+    SettingsDocument();
+
+    /**
+     * Read access, never detaches.
+     */
+    const QVariantMap&
+    constMap() const;
+
+    /**
+     * Write access, detaches if shared and bumps the revision.
+     */
+    QVariantMap&
+    map();
+
+    quint64
+    revision() const;
+
+    void
+    swap(SettingsDocument &other);
+
+private:
+
+    QSharedDataPointer<SettingsDocumentData>
+    d;
+
+};
 
 /**
  * SettingsManager is a generic accessor for loading and saving
@@ -72,6 +175,10 @@ public:
      */
     SettingsManager();
     SettingsManager(const SettingsManager &other);
+    ~SettingsManager();
+
+    SettingsManager&
+    operator=(const SettingsManager &other);
 
     /**
      * Config path, for example: ~/.config/<application>/
@@ -101,6 +208,24 @@ public:
     void
     enableVariantPrefix(bool use_prefix);
 
+    /**
+     * Enables a binary (CBOR) snapshot of the config next to the JSON file.
+     * It is used instead of parsing the JSON file as long as it matches
+     * the JSON file (modification time and hash), otherwise the JSON file
+     * is parsed and the snapshot rewritten.
+     */
+    static void
+    setInitBinaryCache(bool use_cache);
+
+    bool
+    hasBinaryCache() const;
+
+    /**
+     * Binary snapshot file, for example: ~/.config/<application>/config.cbor
+     */
+    QFileInfo
+    cacheFileInfo() const;
+
     /**
      * Returns a temporary settings manager object for a group.
      * This can be used to access several elements within the same dictionary,
@@ -133,6 +258,9 @@ public:
     QVariant
     variant(const QString &key, const QVariant &default_value = QVariant()) const;
 
+    QVariant
+    variant(const SettingsKey &key, const QVariant &default_value = QVariant()) const;
+
     /**
      * Inserts or replaces the value at the specified key,
      * where key is interpreted in the same way as in the getter function.
@@ -145,18 +273,129 @@ public:
     void
     setVariant(const QString &key, const QVariant &value);
 
+    void
+    setVariant(const SettingsKey &key, const QVariant &value);
+
+    /**
+     * Parses key once (see variant() for the format) and returns a handle
+     * that can be kept for repeated access. Parsed keys are also cached
+     * internally, so string accessors only parse a key once.
+     */
+    SettingsKey
+    compileKey(const QString &key) const;
+
+    /**
+     * Change notifications for this object (and group accessors
+     * that modify it), created on first use.
+     * Copies of this object have their own notifier.
+     */
+    SettingsNotifier*
+    notifier();
+
+    /**
+     * Calls member of receiver (see SettingsNotifier::subscribe())
+     * when the value at key (see variant() for the format) changes.
+     */
+    bool
+    subscribe(const QString &key, QObject *receiver, const char *member);
+
     //QVariant
     //setDefaultVariant(const QString &key, const QVariant &default_value);
 
     QStringList
     keys(const QString &key = "", bool with_sub_maps = false) const;
 
+    /**
+     * (Re)loads the config file, replacing the current data.
+     * Called by the constructor.
+     */
+    bool
+    load();
+
+    /**
+     * Reads and parses a config file without touching any settings object,
+     * so it can be called in a worker thread. Returns a map with
+     * "ok", "hash" (of file contents) and "data".
+     */
+    static QVariantMap
+    readConfigFile(const QString &path);
+
+    /**
+     * Replaces the data with data read from the config file
+     * (see readConfigFile()), the result is not dirty.
+     * Returns false (and keeps the data) if there are unsaved changes,
+     * unless discard_changes is set.
+     */
+    bool
+    setLoadedData(const QVariantMap &data, const QByteArray &file_hash, bool discard_changes = false);
+
+    /**
+     * Hash of the config file as last loaded or saved.
+     * save() does not overwrite the file if its hash is different.
+     */
+    QByteArray
+    fileHash() const;
+
+    /**
+     * Accepts the file with this hash as the one to be overwritten
+     * by the next save(), for example to keep the own changes
+     * after the file has been changed by another program.
+     */
+    void
+    setFileHash(const QByteArray &file_hash);
+
+    /**
+     * Writes the config file, if it has been modified.
+     * Fails if the file has been changed by another program (see fileHash()).
+     * The file is replaced atomically (written to a temporary file,
+     * synced and renamed), so a crash never leaves a partial config.
+     */
     bool
     save();
 
+    /**
+     * Schedules save(), restarting the delay on every call,
+     * so a burst of changes results in one write.
+     */
+    void
+    saveLater(int delay_ms = 500);
+
+    /**
+     * Writes a pending (scheduled) save now, for the shutdown path.
+     */
+    bool
+    flush();
+
+    bool
+    isDirty() const;
+
+    /**
+     * The data as it is now, O(1) (shared until modified),
+     * to roll back a failed change with restoreDocument().
+     */
+    SettingsDocument
+    document() const;
+
+    /**
+     * Replaces the data with a document returned by document(),
+     * dirty as it was then.
+     */
+    void
+    restoreDocument(const SettingsDocument &document, bool dirty);
+
+    /**
+     * Replaces our data with that of other, O(1) (shared until modified).
+     */
     void
     replaceWith(const SettingsManager &other);
 
+    /**
+     * Revision of the data, changes whenever the data is modified.
+     * Can be used to validate caches built from the data.
+     */
+    quint64
+    revision() const;
+
 protected:
 
     /**
@@ -178,20 +417,78 @@ protected:
     QPair<QStringList, QString>
     splitItemKey(const QString &key, bool use_default_group = true) const;
 
+    /**
+     * Returns pointer to nested map at key within map (no copy),
+     * 0 if there is no such map.
+     */
+    static const QVariantMap*
+    constChildMap(const QVariantMap *map, const QString &key);
+
+    /**
+     * Returns pointer to nested map at key within map for modification,
+     * the nested map is created if missing.
+     */
+    static QVariantMap*
+    childMap(QVariantMap *map, const QString &key);
+
+    /**
+     * Must be called when m_state is changed in a way that affects
+     * how keys are split (group, prefix, default group).
+     */
+    void
+    invalidateKeys();
+
+    /**
+     * Reports a change at dict_keys.item_key to the notifier, if any.
+     * An empty path (no keys) means that the whole document has changed.
+     */
+    void
+    notifyChanged(const QStringList &dict_keys = QStringList(), const QString &item_key = "");
+
+    /**
+     * Writes the binary snapshot of data, as parsed from the JSON file.
+     */
+    bool
+    writeCache(const QVariantMap &data, const QByteArray &hash, qint64 mtime) const;
+
     QVariantMap
     m_state; //internal settings, do not confuse with m_data!
 
 private:
 
-    QVariantMap
-    m_data_obj; //copy of data dict within object
+    SettingsDocument
+    m_data_obj; //data document within object (shared copy-on-write)
 
-    QVariantMap
-    *m_data; //full map with user data loaded from config
+    SettingsDocument
+    *m_data; //full document with user data loaded from config
+
+    const QVariantMap&
+    data() const;
+
+    QVariantMap&
+    mutableData();
+
+    QTimer
+    *m_tmr_save; //debounce timer for saveLater(), not copied
+
+    QPointer<SettingsNotifier>
+    m_notifier; //not copied, shared with group accessor (modify_parent)
+
+    bool
+    m_own_notifier;
+
+    mutable QHash<QString, SettingsKey>
+    m_key_cache;
+
+    quint64
+    m_key_serial;
 
     static QVariantMap&
     stateMap();
 
+    static quint64
+    nextKeySerial();
+
 };
 
 #endif
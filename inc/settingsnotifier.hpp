@@ -0,0 +1,86 @@
+#ifndef SETTINGSNOTIFIER_HPP
+#define SETTINGSNOTIFIER_HPP
+
+#include <QDebug>
+#include <QObject>
+#include <QPointer>
+#include <QMetaMethod>
+#include <QStringList>
+
+/**
+ * SettingsNotifier reports changes of a settings document by key path
+ * (for example "main.size" or "mount_list"), see SettingsManager::notifier().
+ * Changes are collected and delivered once per event loop iteration,
+ * so a burst of writes results in one notification per subscriber.
+ * A subscriber is only notified if a change touches its key path,
+ * i.e. the path itself, a value below it or a map above it.
+ * An empty path means that the whole document has been replaced.
+ */
+class SettingsNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    SettingsNotifier(QObject *parent = 0);
+
+    /**
+     * Calls member (SLOT() or SIGNAL()) of receiver when path changes.
+     * The member may take a QStringList argument (changed paths).
+     * The subscription ends when the receiver is destroyed.
+     */
+    bool
+    subscribe(const QString &path, QObject *receiver, const char *member);
+
+    /**
+     * Removes subscriptions of receiver, all if path is empty.
+     */
+    void
+    unsubscribe(QObject *receiver, const QString &path = "");
+
+    /**
+     * Records a change, delivered in the next event loop iteration.
+     */
+    void
+    notify(const QString &path);
+
+    /**
+     * True if a change at changed_path affects subscribed_path.
+     */
+    static bool
+    affects(const QString &changed_path, const QString &subscribed_path);
+
+signals:
+
+    /**
+     * All paths changed since the last delivery.
+     */
+    void
+    changed(const QStringList &paths);
+
+private slots:
+
+    void
+    deliver();
+
+private:
+
+    struct Subscription
+    {
+        QString path;
+        QPointer<QObject> receiver;
+        QMetaMethod method;
+    };
+
+    QList<Subscription>
+    m_subscriptions;
+
+    QStringList
+    m_pending;
+
+    bool
+    m_scheduled;
+
+};
+
+#endif
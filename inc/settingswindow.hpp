@@ -25,6 +25,7 @@
 #include <QInputDialog>
 #include <QVBoxLayout>
 #include <QFormLayout>
+#include <QSet>
 #include <QVBoxLayout>
 #include <QVBoxLayout>
 #include <QVBoxLayout>
@@ -35,6 +36,11 @@
 #include "gui.hpp"
 #include "control.hpp"
 #include "mountsettings.hpp"
+#include "settingsjournal.hpp"
+#include "remotecatalog.hpp"
+#include "remotebrowser.hpp"
+#include "remotehealth.hpp"
+#include "itemlist.hpp"
 
 class SettingsWindow : public QDialog
 {
@@ -45,14 +51,17 @@ signals:
     void
     savedSignal();
 
+    /**
+     * Emitted after saving, with the mountpoints that have been changed.
+     */
     void
-    mountsSavedSignal();
+    mountsSavedSignal(const QStringList &mountpoints);
 
 public:
 
     SettingsWindow(MountSettings *settings, QWidget *parent = 0);
 
-    QList<QMap<QString, QVariant>>
+    QList<MountConfig>
     result();
 
 private slots:
@@ -60,6 +69,12 @@ private slots:
     void
     save();
 
+    void
+    undo();
+
+    void
+    redo();
+
     void
     closeEvent(QCloseEvent *event);
 
@@ -69,6 +84,18 @@ private slots:
     void
     loadConnectionsFrame();
 
+    /**
+     * Functions for a mountpoint (rename, remove, ...).
+     */
+    void
+    showMountMenu(const QString &mountpoint, const QPoint &pos);
+
+    /**
+     * Applies the filter text to mounts and connections.
+     */
+    void
+    filterItems();
+
     //void
     //saveSettings();
 
@@ -81,6 +108,21 @@ private slots:
     void
     removeItem();
 
+    void
+    changeProfile();
+
+    void
+    changeRemotePath();
+
+    void
+    toggleAutoMount();
+
+    /**
+     * Shows probe result in the button of remote.
+     */
+    void
+    healthChanged(const QString &remote);
+
     void
     umountItem();
 
@@ -89,28 +131,49 @@ private:
     MountSettings*
     m_settings;
 
-    MountSettings
-    m_settings_new;
+    SettingsJournal
+    m_journal;
+
+    QPushButton
+    *m_btn_undo;
+
+    QPushButton
+    *m_btn_redo;
 
     QTabWidget
     *m_tab_widget;
 
-    QWidget
-    *m_wid_mounts;
+    ItemListModel
+    *m_mdl_mounts;
+
+    ItemListView
+    *m_lst_mounts;
+
+    ItemButton
+    *m_btn_no_mounts; //placeholder
+
+    QLineEdit
+    *m_txt_filter;
 
     QWidget
     *m_wid_conns;
 
-    QString
-    getRcloneConfigPath();
+    QHash<QString, QPointer<ItemButton>>
+    m_conn_btns; //remote => button
 
-    QStringList
-    getConnectionNames();
+    ItemButton
+    *m_btn_no_conns; //placeholder
+
+    void
+    updateJournalButtons();
+
+    QList<MountConfig>
+    mountConfigList();
 
     QStringList
     getMountpoints();
 
-    QVariantMap
+    MountConfig
     getMountpointInfo(const QDir &mountpoint);
 
     bool
@@ -122,6 +185,12 @@ private:
     bool
     isDirectoryEmpty(const QDir &dir);
 
+    static QString
+    mountSubtitle(const MountConfig &cfg);
+
+    static QString
+    connectionSubtitle(const RemoteInfo &remote);
+
 
 
 };
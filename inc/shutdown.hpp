@@ -0,0 +1,107 @@
+#ifndef SHUTDOWN_HPP
+#define SHUTDOWN_HPP
+
+#include <cassert>
+
+#include <QDebug>
+#include <QApplication>
+#include <QProgressDialog>
+#include <QPointer>
+#include <QTimer>
+#include <QSet>
+
+#include "control.hpp"
+
+/**
+ * ShutdownCoordinator takes care of active mounts when the program quits.
+ * With the policy KeepMounts, all mounts are left running.
+ * With UnmountAll, all mounts are unmounted concurrently:
+ * each mount waits until its VFS cache has no pending uploads (rc vfs/stats),
+ * then it is unmounted. When the deadline is reached, remaining mounts
+ * are detached and their processes killed (in parallel, without blocking). So shutdown takes as long as
+ * the slowest mount, not the sum of all mounts.
+ *
+ * finished() is emitted once, when all mounts are done.
+ */
+class ShutdownCoordinator : public QObject
+{
+    Q_OBJECT
+
+signals:
+
+    void
+    finished();
+
+public:
+
+    enum Policy
+    {
+        KeepMounts,
+        UnmountAll
+    };
+
+    ShutdownCoordinator(Policy policy, int deadline_ms = 30000, QWidget *parent = 0);
+
+public slots:
+
+    void
+    start();
+
+private slots:
+
+    void
+    poll();
+
+    void
+    statsReceived();
+
+    void
+    mountFinished(const QString &mountpoint);
+
+    void
+    deadlineReached();
+
+    void
+    finish();
+
+private:
+
+    void
+    updateProgress();
+
+    Policy
+    m_policy;
+
+    QWidget*
+    m_parent;
+
+    QMap<QString, QPointer<MountControl>>
+    m_pending;
+
+    QSet<QString>
+    m_umounting;
+
+    QSet<QString>
+    m_polling; //stats request in progress
+
+    int
+    m_total;
+
+    bool
+    m_finished;
+
+    bool
+    m_forcing; //deadline reached
+
+    QTimer
+    m_tmr_poll;
+
+    QTimer
+    m_tmr_deadline;
+
+    QPointer<QProgressDialog>
+    m_dlg_progress;
+
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef STARTUPPROFILE_HPP
+#define STARTUPPROFILE_HPP
+
+#include <QDebug>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QHash>
+
+/**
+ * StartupProfile records how long each startup phase takes
+ * (enabled with --profile-startup). Times are measured from the creation
+ * of the profile, at the top of main().
+ * report() prints each phase with the time since start and since the
+ * previous phase, and warns about phases that are over their budget.
+ */
+class StartupProfile : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    static StartupProfile*
+    globalInstance();
+
+    StartupProfile(QObject *parent = 0);
+
+    void
+    setEnabled(bool enabled);
+
+    bool
+    isEnabled() const;
+
+    /**
+     * Maximum time (since start) for phase, checked by report().
+     */
+    void
+    setBudget(const QString &phase, int budget_ms);
+
+    /**
+     * Records that phase has been reached.
+     */
+    void
+    mark(const QString &phase);
+
+public slots:
+
+    void
+    report();
+
+private:
+
+    bool
+    m_enabled;
+
+    QElapsedTimer
+    m_timer;
+
+    QList<QPair<QString, qint64>>
+    m_marks;
+
+    QHash<QString, int>
+    m_budgets;
+
+};
+
+#endif
@@ -4,7 +4,8 @@ OBJECTS_DIR = obj/
 INCLUDEPATH = inc/
 HEADERS = inc/*
 SOURCES = src/*
-QT += widgets
+QT += widgets network concurrent
+CONFIG += c++17
 
 DEFINES += PROGRAM=\\\"rclone-ctl-gui\\\"
 
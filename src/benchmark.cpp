@@ -0,0 +1,312 @@
+#include "benchmark.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+MountBenchmark::MountBenchmark(const QDir &dir, const QVariantMap &workload)
+              : QObject(),
+                m_dir(dir),
+                m_canceled(0)
+{
+    m_workload = defaultWorkload();
+    foreach (QString key, workload.keys())
+        m_workload[key] = workload[key];
+}
+
+QVariantMap
+MountBenchmark::defaultWorkload()
+{
+    QVariantMap workload;
+    workload["file_size_mb"] = 64;
+    workload["block_size_kb"] = 1024;
+    workload["random_reads"] = 256;
+    workload["small_files"] = 100;
+    workload["small_file_kb"] = 4;
+    workload["readdir_entries"] = 1000;
+    workload["readdir_passes"] = 5;
+    return workload;
+}
+
+QString
+MountBenchmark::formatResults(const QList<QVariantMap> &results)
+{
+    //Metrics shown for each test, in this order
+    QStringList metrics;
+    metrics << "mb_per_s" << "ops_per_s" << "p50_ms" << "p90_ms" << "p99_ms" << "max_ms";
+
+    //Test names in order of first result
+    QStringList tests;
+    foreach (const QVariantMap &result, results)
+    {
+        foreach (QVariant v, result.value("tests").toList())
+        {
+            QString name = v.toMap().value("name").toString();
+            if (!tests.contains(name)) tests << name;
+        }
+    }
+
+    //Header: one column per profile
+    QString text;
+    text += QString("%1 %2").arg("", -16).arg("", -10);
+    foreach (const QVariantMap &result, results)
+        text += QString(" %1").arg(result.value("profile").toString().left(14), 14);
+    text += "\n";
+
+    foreach (QString test, tests)
+    {
+        foreach (QString metric, metrics)
+        {
+            QString line = QString("%1 %2").arg(test, -16).arg(metric, -10);
+            foreach (const QVariantMap &result, results)
+            {
+                QString cell = "-";
+                foreach (QVariant v, result.value("tests").toList())
+                {
+                    QVariantMap test_result = v.toMap();
+                    if (test_result.value("name").toString() != test) continue;
+                    if (test_result.contains(metric))
+                        cell = QString::number(test_result.value(metric).toDouble(), 'f', 2);
+                }
+                line += QString(" %1").arg(cell, 14);
+            }
+            text += line + "\n";
+        }
+    }
+
+    return text;
+}
+
+void
+MountBenchmark::cancel()
+{
+    m_canceled.storeRelease(1);
+}
+
+void
+MountBenchmark::run()
+{
+    QVariantMap result;
+    QVariantList tests;
+
+    //Private work directory within mountpoint, removed afterwards
+    QString work_name = QString(".rclone-ctl-bench-%1").arg(QCoreApplication::applicationPid());
+    QDir work_dir(m_dir.filePath(work_name));
+    if (!m_dir.mkpath(work_name))
+    {
+        result["error"] = tr("Failed to create work directory: %1").arg(work_dir.path());
+        emit finished(result);
+        return;
+    }
+    QString file_path = work_dir.filePath("sequential.dat");
+
+    emit progress(tr("Sequential write..."));
+    if (!isCanceled()) tests << runSequentialWrite(file_path);
+    emit progress(tr("Sequential read..."));
+    if (!isCanceled()) tests << runSequentialRead(file_path);
+    emit progress(tr("Random 4K read..."));
+    if (!isCanceled()) tests << runRandomRead(file_path);
+    emit progress(tr("Small file create..."));
+    if (!isCanceled()) tests << runSmallFiles(QDir(work_dir.filePath("small")));
+    emit progress(tr("Directory listing..."));
+    if (!isCanceled()) tests << runReaddir(QDir(work_dir.filePath("readdir")));
+
+    emit progress(tr("Cleaning up..."));
+    work_dir.removeRecursively();
+
+    if (isCanceled())
+        result["error"] = tr("Canceled");
+    result["tests"] = tests;
+    emit finished(result);
+}
+
+bool
+MountBenchmark::isCanceled() const
+{
+    return m_canceled.loadAcquire();
+}
+
+int
+MountBenchmark::setting(const QString &key) const
+{
+    return qMax(1, m_workload.value(key).toInt());
+}
+
+QVariantMap
+MountBenchmark::runSequentialWrite(const QString &file_path)
+{
+    QFile file(file_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QVariantMap();
+
+    qint64 block_size = setting("block_size_kb") * 1024LL;
+    qint64 block_count = setting("file_size_mb") * 1024LL * 1024 / block_size;
+    QByteArray block(int(block_size), 'x');
+    QVector<qint64> latencies;
+    latencies.reserve(block_count);
+
+    QElapsedTimer total;
+    total.start();
+    for (qint64 i = 0; i < block_count && !isCanceled(); i++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (file.write(block) != block_size) break;
+        latencies << timer.nsecsElapsed();
+    }
+    //Data must have left the page cache for the result to mean anything
+    file.flush();
+    fsync(file.handle());
+    file.close();
+
+    return summarize("seq_write", latencies, latencies.size(), latencies.size() * block_size, total.nsecsElapsed());
+}
+
+QVariantMap
+MountBenchmark::runSequentialRead(const QString &file_path)
+{
+    QFile file(file_path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return QVariantMap();
+    //Ask kernel to drop cached pages, best effort
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED);
+
+    qint64 block_size = setting("block_size_kb") * 1024LL;
+    QByteArray block(int(block_size), 0);
+    QVector<qint64> latencies;
+    qint64 bytes = 0;
+
+    QElapsedTimer total;
+    total.start();
+    while (!isCanceled())
+    {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 n = file.read(block.data(), block_size);
+        if (n <= 0) break;
+        latencies << timer.nsecsElapsed();
+        bytes += n;
+    }
+
+    return summarize("seq_read", latencies, latencies.size(), bytes, total.nsecsElapsed());
+}
+
+QVariantMap
+MountBenchmark::runRandomRead(const QString &file_path)
+{
+    QFile file(file_path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return QVariantMap();
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED);
+
+    const qint64 block_size = 4096;
+    qint64 block_count = file.size() / block_size;
+    if (block_count < 1) return QVariantMap();
+    int count = setting("random_reads");
+    QByteArray block(int(block_size), 0);
+    QVector<qint64> latencies;
+    latencies.reserve(count);
+    qint64 bytes = 0;
+
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < count && !isCanceled(); i++)
+    {
+        qint64 offset = QRandomGenerator::global()->bounded(int(block_count)) * block_size;
+        QElapsedTimer timer;
+        timer.start();
+        if (!file.seek(offset)) break;
+        qint64 n = file.read(block.data(), block_size);
+        if (n <= 0) break;
+        latencies << timer.nsecsElapsed();
+        bytes += n;
+    }
+
+    return summarize("rand_read_4k", latencies, latencies.size(), bytes, total.nsecsElapsed());
+}
+
+QVariantMap
+MountBenchmark::runSmallFiles(const QDir &dir)
+{
+    if (!QDir().mkpath(dir.path())) return QVariantMap();
+
+    int count = setting("small_files");
+    QByteArray data(setting("small_file_kb") * 1024, 'x');
+    QVector<qint64> latencies;
+    latencies.reserve(count);
+
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < count && !isCanceled(); i++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QFile file(dir.filePath(QString("file_%1").arg(i)));
+        if (!file.open(QIODevice::WriteOnly)) break;
+        file.write(data);
+        file.close();
+        latencies << timer.nsecsElapsed();
+    }
+
+    return summarize("small_create", latencies, latencies.size(), latencies.size() * data.size(), total.nsecsElapsed());
+}
+
+QVariantMap
+MountBenchmark::runReaddir(const QDir &dir)
+{
+    if (!QDir().mkpath(dir.path())) return QVariantMap();
+
+    //Populate directory (not timed)
+    int entries = setting("readdir_entries");
+    for (int i = 0; i < entries && !isCanceled(); i++)
+    {
+        QFile file(dir.filePath(QString("entry_%1").arg(i)));
+        if (!file.open(QIODevice::WriteOnly)) break;
+    }
+
+    int passes = setting("readdir_passes");
+    QVector<qint64> latencies;
+    qint64 listed = 0;
+
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < passes && !isCanceled(); i++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QDir list_dir(dir.path()); //new object, no cached listing
+        listed += list_dir.entryList(QDir::Files | QDir::NoDotAndDotDot).size();
+        latencies << timer.nsecsElapsed();
+    }
+
+    //One operation per listed entry, latency per full listing
+    return summarize("readdir", latencies, listed, 0, total.nsecsElapsed());
+}
+
+QVariantMap
+MountBenchmark::summarize(const QString &name, QVector<qint64> latencies, qint64 ops, qint64 bytes, qint64 elapsed_ns)
+{
+    QVariantMap result;
+    result["name"] = name;
+    result["ops"] = ops;
+    result["bytes"] = bytes;
+    double seconds = elapsed_ns / 1e9;
+    result["seconds"] = seconds;
+    if (seconds > 0)
+    {
+        if (bytes) result["mb_per_s"] = bytes / (1024.0 * 1024.0) / seconds;
+        result["ops_per_s"] = ops / seconds;
+    }
+
+    //Latency percentiles (nearest rank)
+    if (!latencies.isEmpty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        int n = latencies.size();
+        result["p50_ms"] = latencies[qMin(n - 1, n * 50 / 100)] / 1e6;
+        result["p90_ms"] = latencies[qMin(n - 1, n * 90 / 100)] / 1e6;
+        result["p99_ms"] = latencies[qMin(n - 1, n * 99 / 100)] / 1e6;
+        result["max_ms"] = latencies.last() / 1e6;
+    }
+
+    return result;
+}
@@ -0,0 +1,421 @@
+#include "benchmarkwindow.hpp"
+
+BenchmarkWindow::BenchmarkWindow(MountSettings *settings, const QString &mountpoint, QWidget *parent)
+               : QDialog(parent),
+                 m_settings(settings),
+                 m_mountpoint(mountpoint),
+                 m_running(false),
+                 m_umounting(false),
+                 m_was_mounted(false),
+                 m_close_pending(false)
+{
+    setWindowTitle(tr("Benchmark: %1").arg(mountpoint));
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    //Main layout
+    QVBoxLayout *vbox = new QVBoxLayout;
+    setLayout(vbox);
+
+    //Remote and workload
+    QFormLayout *form = new QFormLayout;
+    vbox->addLayout(form);
+    m_orig_conn = settings->mount(mountpoint).connection;
+    m_txt_remote = new QLineEdit(m_orig_conn);
+    m_txt_remote->setToolTip(tr("Connection name, \":memory:\" or a local path"));
+    form->addRow(tr("Remote"), m_txt_remote);
+    QVariantMap workload = MountBenchmark::defaultWorkload();
+    QVariantMap saved_workload = settings->variant("benchmark_workload").toMap();
+    foreach (QString key, saved_workload.keys())
+        workload[key] = saved_workload[key];
+    QStringList workload_keys;
+    workload_keys << "file_size_mb" << "block_size_kb" << "random_reads"
+        << "small_files" << "small_file_kb" << "readdir_entries" << "readdir_passes";
+    foreach (QString key, workload_keys)
+    {
+        QSpinBox *spn = new QSpinBox;
+        spn->setRange(1, 1000000);
+        spn->setValue(workload.value(key).toInt());
+        form->addRow(key, spn);
+        m_spn_workload[key] = spn;
+    }
+
+    //Tuning profiles, one per line: name = rclone arguments
+    vbox->addWidget(new QLabel(tr("Profiles (name = rclone arguments), leave empty to test the current mount:")));
+    m_txt_profiles = new QPlainTextEdit;
+    QStringList profile_lines;
+    QVariantList profile_list;
+    if (settings->variant("benchmark_profiles").isValid())
+    {
+        profile_list = settings->variant("benchmark_profiles").toList();
+    }
+    else
+    {
+        //Default profiles, compared on first run
+        QVariantMap p1, p2, p3;
+        p1["name"] = "default";
+        p2["name"] = "vfs-writes";
+        p2["args"] = "--vfs-cache-mode writes";
+        p3["name"] = "vfs-full";
+        p3["args"] = "--vfs-cache-mode full --buffer-size 32M";
+        profile_list << p1 << p2 << p3;
+    }
+    foreach (QVariant v, profile_list)
+    {
+        QVariantMap profile = v.toMap();
+        profile_lines << QString("%1 = %2").arg(profile["name"].toString(), profile["args"].toString());
+    }
+    m_txt_profiles->setPlainText(profile_lines.join("\n"));
+    m_txt_profiles->setMaximumHeight(100);
+    vbox->addWidget(m_txt_profiles);
+
+    //Output
+    m_txt_output = new QPlainTextEdit;
+    m_txt_output->setReadOnly(true);
+    QFont fnt_output = m_txt_output->font();
+    fnt_output.setFamily("Monospace");
+    fnt_output.setStyleHint(QFont::TypeWriter);
+    m_txt_output->setFont(fnt_output);
+    vbox->addWidget(m_txt_output);
+
+    //Buttons
+    QHBoxLayout *hbox = new QHBoxLayout;
+    m_btn_run = new QPushButton(tr("&Run"));
+    connect(m_btn_run, SIGNAL(clicked()), SLOT(run()));
+    hbox->addWidget(m_btn_run);
+    m_btn_cancel = new QPushButton(tr("C&ancel"));
+    m_btn_cancel->setDisabled(true);
+    connect(m_btn_cancel, SIGNAL(clicked()), SLOT(cancel()));
+    hbox->addWidget(m_btn_cancel);
+    hbox->addStretch();
+    QPushButton *btn_close = new QPushButton(tr("&Close"));
+    connect(btn_close, SIGNAL(clicked()), SLOT(close()));
+    hbox->addWidget(btn_close);
+    vbox->addLayout(hbox);
+
+    //Mount timeout (rclone did not come up)
+    m_tmr_mount.setSingleShot(true);
+    m_tmr_mount.setInterval(30000);
+    connect(&m_tmr_mount, SIGNAL(timeout()), SLOT(mountTimeout()));
+
+    resize(700, 600);
+}
+
+void
+BenchmarkWindow::closeEvent(QCloseEvent *event)
+{
+    //A profile mount may still be active, the window closes
+    //once the original mount has been restored (see runFinished())
+    if (m_running)
+    {
+        m_close_pending = true;
+        cancel();
+        event->ignore();
+        return;
+    }
+    event->accept();
+}
+
+void
+BenchmarkWindow::reject()
+{
+    //Esc, same as closing the window
+    if (m_running)
+    {
+        m_close_pending = true;
+        cancel();
+        return;
+    }
+    QDialog::reject();
+}
+
+void
+BenchmarkWindow::run()
+{
+    if (m_running) return;
+    saveProfiles();
+    m_results.clear();
+    m_queue = profiles();
+    m_mount = MountControl::fromMountpoint(m_mountpoint);
+    m_was_mounted = m_mount && m_mount->isMounted();
+
+    if (m_queue.isEmpty())
+    {
+        //No profiles, test current mount as is
+        if (!m_was_mounted)
+        {
+            QMessageBox::critical(this, tr("Benchmark"),
+                tr("This mountpoint is not mounted. Mount it or define profiles."));
+            return;
+        }
+        m_running = true;
+        m_btn_run->setDisabled(true);
+        m_btn_cancel->setDisabled(false);
+        m_cur_profile = "current";
+        startWorker();
+        return;
+    }
+
+    m_running = true;
+    m_btn_run->setDisabled(true);
+    m_btn_cancel->setDisabled(false);
+    nextProfile();
+}
+
+void
+BenchmarkWindow::cancel()
+{
+    if (!m_running) return;
+    m_queue.clear();
+    m_tmr_mount.stop();
+    m_btn_cancel->setDisabled(true);
+    if (m_worker)
+    {
+        m_worker->cancel(); //workerFinished() will follow
+        return;
+    }
+    if (!m_after_umount.isEmpty())
+    {
+        //Waiting for umount, don't mount the next profile
+        if (m_after_umount == "mountProfile")
+            m_after_umount = "finish";
+        return;
+    }
+    finish();
+}
+
+void
+BenchmarkWindow::nextProfile()
+{
+    if (m_queue.isEmpty())
+    {
+        finish();
+        return;
+    }
+
+    //Remount with profile arguments
+    QPair<QString, QStringList> profile = m_queue.takeFirst();
+    m_cur_profile = profile.first;
+    m_cur_args = profile.second;
+    umountCurrent("mountProfile");
+}
+
+void
+BenchmarkWindow::mountProfile()
+{
+    print(tr("[%1] mounting %2 %3").arg(m_cur_profile, m_txt_remote->text(), m_cur_args.join(" ")));
+    m_mount = MountControl::fromMountpoint(m_mountpoint, m_txt_remote->text());
+    if (!m_mount)
+    {
+        print(tr("[%1] no remote").arg(m_cur_profile));
+        finish();
+        return;
+    }
+    m_mount->setConnection(m_txt_remote->text());
+    bool orig_remote = m_txt_remote->text() == m_orig_conn;
+    m_mount->setRemotePath(orig_remote ? m_settings->mount(m_mountpoint).remote_path : QString());
+    m_mount->setExtraArguments(m_cur_args);
+    emit mountCreated(m_mount.data());
+    connect(m_mount.data(), SIGNAL(mountedSignal(const QString&)), SLOT(mountReady(const QString&)));
+    connect(m_mount.data(), SIGNAL(umountedSignal(const QString&, int, const QByteArray&)), SLOT(mountStopped(const QString&, int, const QByteArray&)));
+    m_mount->mount();
+    m_tmr_mount.start();
+}
+
+void
+BenchmarkWindow::mountReady(const QString &mountpoint)
+{
+    if (!m_running || mountpoint != m_mountpoint) return;
+    m_tmr_mount.stop();
+    startWorker();
+}
+
+void
+BenchmarkWindow::mountStopped(const QString &mountpoint, int rc, const QByteArray &err_output)
+{
+    //Unexpected end of mount process (not by umountCurrent())
+    if (!m_running || m_umounting || mountpoint != m_mountpoint) return;
+    m_tmr_mount.stop();
+    print(tr("[%1] mount failed (%2): %3").arg(m_cur_profile).arg(rc).arg(QString(err_output).trimmed()));
+    if (m_worker)
+    {
+        m_worker->cancel();
+        return;
+    }
+    QTimer::singleShot(0, this, SLOT(nextProfile()));
+}
+
+void
+BenchmarkWindow::mountTimeout()
+{
+    print(tr("[%1] mount timed out").arg(m_cur_profile));
+    QTimer::singleShot(0, this, SLOT(nextProfile()));
+}
+
+void
+BenchmarkWindow::startWorker()
+{
+    print(tr("[%1] running workload").arg(m_cur_profile));
+
+    //Worker runs blocking file operations in its own thread
+    QThread *thread = new QThread;
+    m_worker = new MountBenchmark(QDir(m_mountpoint), workload());
+    m_worker->moveToThread(thread);
+    connect(thread, SIGNAL(started()), m_worker.data(), SLOT(run()));
+    connect(m_worker.data(), SIGNAL(progress(const QString&)), SLOT(showProgress(const QString&)));
+    connect(m_worker.data(), SIGNAL(finished(const QVariantMap&)), SLOT(workerFinished(const QVariantMap&)));
+    connect(m_worker.data(), SIGNAL(finished(const QVariantMap&)), thread, SLOT(quit()));
+    connect(thread, SIGNAL(finished()), m_worker.data(), SLOT(deleteLater()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start();
+}
+
+void
+BenchmarkWindow::showProgress(const QString &text)
+{
+    print(QString("[%1] %2").arg(m_cur_profile, text));
+}
+
+void
+BenchmarkWindow::workerFinished(const QVariantMap &result)
+{
+    m_worker = 0;
+    QVariantMap profile_result = result;
+    profile_result["profile"] = m_cur_profile;
+    if (result.contains("error"))
+        print(tr("[%1] error: %2").arg(m_cur_profile, result["error"].toString()));
+    else
+        m_results << profile_result;
+
+    if (!m_running) return;
+    if (m_queue.isEmpty() && m_cur_profile == "current")
+    {
+        finish();
+        return;
+    }
+    nextProfile();
+}
+
+QList<QPair<QString, QStringList>>
+BenchmarkWindow::profiles() const
+{
+    QList<QPair<QString, QStringList>> list;
+    foreach (QString line, m_txt_profiles->toPlainText().split('\n'))
+    {
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+        QString name = line.section('=', 0, 0).trimmed();
+        QString args = line.section('=', 1).trimmed();
+        list << qMakePair(name, args.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts));
+    }
+    return list;
+}
+
+void
+BenchmarkWindow::saveProfiles()
+{
+    QVariantList profile_list;
+    QList<QPair<QString, QStringList>> list = profiles();
+    for (int i = 0; i < list.size(); i++)
+    {
+        QVariantMap profile;
+        profile["name"] = list[i].first;
+        profile["args"] = list[i].second.join(" ");
+        profile_list << profile;
+    }
+    m_settings->setVariant("benchmark_profiles", profile_list);
+    m_settings->setVariant("benchmark_workload", workload());
+    m_settings->saveLater();
+}
+
+QVariantMap
+BenchmarkWindow::workload() const
+{
+    QVariantMap workload;
+    foreach (QString key, m_spn_workload.keys())
+        workload[key] = m_spn_workload[key]->value();
+    return workload;
+}
+
+void
+BenchmarkWindow::umountCurrent(const char *next)
+{
+    //Asynchronous, the slot next is invoked when the mount is gone
+    m_after_umount = next;
+    if (!m_mount || !m_mount->isMounted())
+    {
+        QTimer::singleShot(0, this, SLOT(umountFinished()));
+        return;
+    }
+    m_umounting = true;
+    connect(m_mount.data(), SIGNAL(umountedSignal(const QString&, int, const QByteArray&)), SLOT(umountFinished()));
+    m_mount->requestUmount();
+}
+
+void
+BenchmarkWindow::umountFinished()
+{
+    if (m_mount)
+    {
+        disconnect(m_mount.data(), 0, this, 0);
+        m_mount->discard();
+        m_mount = 0;
+    }
+    m_umounting = false;
+    QByteArray next = m_after_umount;
+    m_after_umount.clear();
+    QMetaObject::invokeMethod(this, next.constData());
+}
+
+void
+BenchmarkWindow::finish()
+{
+    bool compared = m_cur_profile != "current";
+    m_btn_cancel->setDisabled(true);
+
+    //Side-by-side comparison
+    if (!m_results.isEmpty())
+        print(MountBenchmark::formatResults(m_results));
+
+    //Restore previous state, profile mounts are only temporary
+    if (compared)
+    {
+        umountCurrent("restoreMount");
+        return;
+    }
+    runFinished();
+}
+
+void
+BenchmarkWindow::restoreMount()
+{
+    if (m_was_mounted)
+    {
+        m_mount = MountControl::fromMountpoint(m_mountpoint, m_orig_conn);
+        if (m_mount)
+        {
+            MountConfig cfg = m_settings->mount(m_mountpoint);
+            m_mount->setConnection(m_orig_conn);
+            m_mount->setRemotePath(cfg.remote_path);
+            m_mount->setExtraArguments(m_settings->profileArguments(cfg.profile));
+            emit mountCreated(m_mount.data());
+            m_mount->mount();
+        }
+        m_mount = 0; //tracked by the main window from here
+    }
+    runFinished();
+}
+
+void
+BenchmarkWindow::runFinished()
+{
+    m_running = false;
+    m_btn_run->setDisabled(false);
+    m_btn_cancel->setDisabled(true);
+    if (m_close_pending) close();
+}
+
+void
+BenchmarkWindow::print(const QString &text)
+{
+    m_txt_output->appendPlainText(text);
+}
@@ -1,5 +1,9 @@
 #include "control.hpp"
 
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mount.h>
+
 QStringList
 MountControl::activeMountpoints()
 {
@@ -9,6 +13,106 @@ MountControl::activeMountpoints()
     return mountpoints;
 }
 
+QList<QPointer<MountControl>>
+MountControl::activeControls()
+{
+    QList<QPointer<MountControl>> list;
+    foreach (QPointer<MountControl> m, activeConnections())
+        if (m && m->isMounted()) list << m;
+    return list;
+}
+
+MountControl::UmountResult
+MountControl::umountPath(const QString &path, bool lazy)
+{
+    const UmountCapabilities &caps = umountCapabilities();
+    QByteArray path_raw = QFile::encodeName(path);
+
+    //Direct system call, no helper process
+    if (caps.native)
+    {
+        if (::umount2(path_raw.constData(), 0) == 0)
+            return UmountOk;
+        int error = errno;
+        if (error == EBUSY && lazy)
+        {
+            //Detach now, kernel finishes when last file is closed
+            if (::umount2(path_raw.constData(), MNT_DETACH) == 0)
+                return UmountOk;
+            error = errno;
+        }
+        return umountResultFromErrno(error);
+    }
+
+    //Unprivileged, setuid helper
+    if (caps.fusermount.isEmpty())
+        return UmountPermissionDenied;
+    UmountResult result = umountHelper(caps.fusermount, path, false);
+    if (result == UmountBusy && lazy)
+        result = umountHelper(caps.fusermount, path, true);
+    return result;
+}
+
+MountControl::UmountResult
+MountControl::umountHelper(const QString &program, const QString &path, bool lazy)
+{
+    QStringList args;
+    args << "-u";
+    if (lazy) args << "-z";
+    args << path;
+    QProcess proc;
+    proc.start(program, args);
+    if (!proc.waitForFinished(5000))
+    {
+        //Hanging helper (dead file system), don't keep the caller waiting
+        proc.kill();
+        proc.waitForFinished(1000);
+        return UmountFailed;
+    }
+    return umountHelperResult(proc);
+}
+
+MountControl::UmountResult
+MountControl::umountHelperResult(QProcess &proc)
+{
+    if (proc.error() == QProcess::FailedToStart)
+        return UmountFailed;
+    if (proc.exitStatus() == QProcess::NormalExit && proc.exitCode() == 0)
+        return UmountOk;
+
+    //Classify helper error message
+    QString err = proc.readAllStandardError();
+    if (err.contains("busy", Qt::CaseInsensitive))
+        return UmountBusy;
+    if (err.contains("not found in", Qt::CaseInsensitive) ||
+        err.contains("Invalid argument", Qt::CaseInsensitive) ||
+        err.contains("No such file", Qt::CaseInsensitive) ||
+        err.contains("not mounted", Qt::CaseInsensitive))
+        return UmountNotMounted;
+    if (err.contains("Permission denied", Qt::CaseInsensitive) ||
+        err.contains("not permitted", Qt::CaseInsensitive))
+        return UmountPermissionDenied;
+    return UmountFailed;
+}
+
+QString
+MountControl::umountResultString(UmountResult result)
+{
+    switch (result)
+    {
+    case UmountOk:
+        return tr("Unmounted");
+    case UmountBusy:
+        return tr("Device or resource busy");
+    case UmountNotMounted:
+        return tr("Not mounted");
+    case UmountPermissionDenied:
+        return tr("Permission denied");
+    default:
+        return tr("Unmount failed");
+    }
+}
+
 QPointer<MountControl>
 MountControl::fromMountpoint(const QDir &mountpoint, const QString &conn, bool return_new)
 {
@@ -39,6 +143,7 @@ MountControl::fromMountpoint(const QDir &mountpoint, bool return_new)
 
 MountControl::MountControl(const QDir &mountpoint)
             : QObject(),
+              m_rc_port(0),
               m_mounted(false)
 {
     m_mountpoint = mountpoint.path();
@@ -61,6 +166,48 @@ MountControl::setConnection(QString conn)
     m_r_conn = conn;
 }
 
+QString
+MountControl::connection() const
+{
+    return m_r_conn;
+}
+
+void
+MountControl::setRemotePath(const QString &path)
+{
+    m_remote_path = path;
+}
+
+QString
+MountControl::remotePath() const
+{
+    return m_remote_path;
+}
+
+void
+MountControl::setExtraArguments(const QStringList &args)
+{
+    m_extra_args = args;
+}
+
+QStringList
+MountControl::extraArguments() const
+{
+    return m_extra_args;
+}
+
+QString
+MountControl::remoteSpec() const
+{
+    //Local path (/tmp/dir) or connection string with backend (:memory:)
+    if (m_r_conn.startsWith('/') || m_r_conn.contains(':'))
+        return m_r_conn;
+
+    //Named connection from rclone.conf
+    QString remote_path = m_remote_path.isEmpty() ? "/" : m_remote_path;
+    return m_r_conn + ":" + remote_path;
+}
+
 bool
 MountControl::isExternallyMounted() const
 {
@@ -83,6 +230,37 @@ MountControl::isMounted() const
     return m_mounted;
 }
 
+int
+MountControl::rcPort() const
+{
+    //Chosen by rclone (port 0), logged on startup:
+    //"NOTICE: Serving remote control on http://127.0.0.1:41265/"
+    if (!m_rc_port && m_mounted)
+    {
+        QFile file(logFilePath());
+        if (file.open(QIODevice::ReadOnly))
+        {
+            QRegularExpression re("Serving remote control on http://127\\.0\\.0\\.1:(\\d+)/");
+            QRegularExpressionMatch match = re.match(QString::fromUtf8(file.read(16384)));
+            if (match.hasMatch())
+                m_rc_port = match.captured(1).toInt();
+        }
+    }
+    return m_rc_port;
+}
+
+QNetworkReply*
+MountControl::rcCall(const QString &method, const QVariantMap &params)
+{
+    if (!m_mounted || !rcPort()) return 0;
+
+    QUrl url(QString("http://127.0.0.1:%1/%2").arg(m_rc_port).arg(method));
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QByteArray body = QJsonDocument(QJsonObject::fromVariantMap(params)).toJson(QJsonDocument::Compact);
+    return networkManager()->post(request, body);
+}
+
 bool
 MountControl::mount()
 {
@@ -106,26 +284,82 @@ MountControl::mount()
     if (m_mounted) return false;
     if (m_r_conn.isEmpty()) return false;
 
+    //Remote control API on a local port picked by rclone itself
+    //(no race with other programs), read back from the log (see rcPort())
+    m_rc_port = 0;
+
     //Mount arguments
-    QString remote_path = "/"; //TODO settings (MountSettings)
     QStringList args; //rclone ...
     args << "mount";
-    args << m_r_conn + ":" + remote_path;
+    args << remoteSpec();
     args << mountpoint();
+    args << "--rc" << "--rc-addr=127.0.0.1:0";
+    args << m_extra_args;
     m_proc.setArguments(args);
+
+    //No pipes: with the shutdown policy "keep", rclone keeps running
+    //after we quit and would die of SIGPIPE on its next log line
+    //(leaving a dead FUSE mount behind).
+    m_proc.setStandardInputFile(QProcess::nullDevice());
+    m_proc.setStandardOutputFile(QProcess::nullDevice());
+    m_proc.setStandardErrorFile(logFilePath()); //truncated
     m_proc.start();
 
     m_mounted = true;
+    return true;
 }
 
 void
-MountControl::umount()
+MountControl::requestUmount()
 {
-    if (!umountSystem())
+    //Unmount the file system, rclone exits on its own when it's gone:
+    //directly if permitted, otherwise through the helper (in the background,
+    //see umountHelperFinished()). If neither works, rclone unmounts itself
+    //on SIGTERM.
+    const UmountCapabilities &caps = umountCapabilities();
+    if (caps.native)
     {
-        m_proc.terminate(); //soft force option
+        if (umountPath(mountpoint(), false) != UmountOk)
+            m_proc.terminate(); //soft force option
+        return;
     }
-    m_proc.waitForFinished();
+    if (caps.fusermount.isEmpty())
+    {
+        m_proc.terminate();
+        return;
+    }
+    startUmountHelper(false);
+}
+
+void
+MountControl::forceUmount()
+{
+    //Detach first, a killed rclone would leave a dead FUSE mount behind.
+    //Never blocks: the helper runs in the background, rclone is killed
+    //when it's done (see umountHelperFinished()).
+    const UmountCapabilities &caps = umountCapabilities();
+    if (caps.native || caps.fusermount.isEmpty())
+    {
+        if (caps.native)
+            umountPath(mountpoint(), true); //system call, detached right away
+        m_proc.kill();
+        return;
+    }
+    startUmountHelper(true);
+}
+
+void
+MountControl::startUmountHelper(bool force)
+{
+    QStringList args;
+    args << "-u";
+    if (force) args << "-z";
+    args << mountpoint();
+    QProcess *proc = new QProcess(this);
+    proc->setProperty("force", force);
+    connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(umountHelperFinished()));
+    connect(proc, SIGNAL(errorOccurred(QProcess::ProcessError)), SLOT(umountHelperFinished()));
+    proc->start(umountCapabilities().fusermount, args);
 }
 
 void
@@ -139,18 +373,36 @@ MountControl::discard()
     deleteLater();
 }
 
-bool
-MountControl::umountSystem()
+MountControl::UmountResult
+MountControl::umountSystem(bool lazy)
 {
-    QProcess proc;
-    proc.setProgram("fusermount");
-    QStringList args;
-    args << "-u" << mountpoint();
-    proc.setArguments(args);
-    proc.start();
+    return umountPath(mountpoint(), lazy);
+}
+
+void
+MountControl::umountHelperFinished()
+{
+    //Finished or failed to start (once, both may be signaled)
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc || proc->property("done").toBool()) return;
+    proc->setProperty("done", true);
+    proc->deleteLater();
+
+    //Detached (or not possible), the process can go
+    if (proc->property("force").toBool())
+    {
+        m_proc.kill();
+        return;
+    }
 
-    proc.waitForFinished();
-    return proc.exitCode() == 0;
+    //Unmounted, rclone notices and exits (umountedSignal() follows).
+    //Busy or helper failed, let rclone try on its own.
+    UmountResult result = umountHelperResult(*proc);
+    if (result != UmountOk && result != UmountNotMounted)
+    {
+        qWarning() << "Unmount helper failed:" << mountpoint() << umountResultString(result);
+        m_proc.terminate();
+    }
 }
 
 void
@@ -186,7 +438,7 @@ void
 MountControl::checkStateFinished(int rc, QProcess::ExitStatus status)
 {
     m_mounted = false;
-    QByteArray err_output = m_proc.readAllStandardError();
+    QByteArray err_output = readLogTail();
     emit umountedSignal(mountpoint(), rc, err_output);
 
     if (status == QProcess::NormalExit)
@@ -203,6 +455,29 @@ MountControl::getRclonePath()
     return bin_dir;
 }
 
+QString
+MountControl::logFilePath() const
+{
+    //One file per mountpoint, in the cache directory
+    QString dir_path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(dir_path);
+    QByteArray hash = QCryptographicHash::hash(m_mountpoint.toUtf8(), QCryptographicHash::Md5).toHex();
+    return QDir(dir_path).filePath(QString("mount-%1.log").arg(QString::fromLatin1(hash)));
+}
+
+QByteArray
+MountControl::readLogTail(qint64 max_size) const
+{
+    QFile file(logFilePath());
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    if (file.size() > max_size)
+        file.seek(file.size() - max_size);
+    QByteArray data = file.readAll();
+    if (file.size() > max_size)
+        data = data.mid(data.indexOf('\n') + 1); //from the first complete line
+    return data.trimmed();
+}
+
 QList<QPointer<MountControl>>&
 MountControl::activeConnections()
 {
@@ -210,3 +485,45 @@ MountControl::activeConnections()
     return mounts;
 }
 
+QNetworkAccessManager*
+MountControl::networkManager()
+{
+    //Shared by all mounts (gui thread)
+    static QNetworkAccessManager *manager = new QNetworkAccessManager(qApp);
+    return manager;
+}
+
+const MountControl::UmountCapabilities&
+MountControl::umountCapabilities()
+{
+    //Determined once, neither privileges nor helpers change at runtime
+    static UmountCapabilities caps;
+    static bool initialized = false;
+    if (!initialized)
+    {
+        caps.native = geteuid() == 0;
+        caps.fusermount = QStandardPaths::findExecutable("fusermount3");
+        if (caps.fusermount.isEmpty())
+            caps.fusermount = QStandardPaths::findExecutable("fusermount");
+        initialized = true;
+    }
+    return caps;
+}
+
+MountControl::UmountResult
+MountControl::umountResultFromErrno(int error)
+{
+    switch (error)
+    {
+    case EBUSY:
+        return UmountBusy;
+    case EINVAL:
+    case ENOENT:
+        return UmountNotMounted;
+    case EPERM:
+    case EACCES:
+        return UmountPermissionDenied;
+    default:
+        return UmountFailed;
+    }
+}
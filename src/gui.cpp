@@ -108,6 +108,12 @@ ItemButton::setHoverFgColor(QColor color)
     updateColor();
 }
 
+void
+ItemButton::setTitle(QString text)
+{
+    m_lbl_title->setText(text);
+}
+
 void
 ItemButton::setSubtitle(QString text)
 {
@@ -168,6 +174,7 @@ ItemButton::addAction(const QString &text)
 void
 ItemButton::updateColor()
 {
+    //Prepared palettes, setPalette() repaints
     if (m_mouse_hover)
     {
         setPalette(m_pal_hover);
@@ -176,17 +183,16 @@ ItemButton::updateColor()
     {
         setPalette(m_pal_default);
     }
-
-    update();
 }
 
 void
 ItemButton::enterEvent(QEvent *event)
 {
-    if (m_disabled) return;
+    if (m_disabled || m_mouse_hover) return;
     m_mouse_hover = true;
 
-    setPalette(m_pal_hover);
+    //Prepared palette, nothing else is looked up on hover
+    updateColor();
 
     emit entered();
 }
@@ -194,11 +200,10 @@ ItemButton::enterEvent(QEvent *event)
 void
 ItemButton::leaveEvent(QEvent *event)
 {
-    if (m_disabled) return;
+    if (m_disabled || !m_mouse_hover) return;
     m_mouse_hover = false;
 
-    setPalette(m_pal_default);
-    update();
+    updateColor();
 
     emit left();
 }
@@ -0,0 +1,596 @@
+#include "itemlist.hpp"
+
+#include <qdrawutil.h>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+//Same metrics as ItemButton
+static const int s_line_width = 2;
+static const int s_margin = 9;
+static const int s_spacing = 5; //between items
+
+bool
+ItemListModel::Item::operator==(const Item &other) const
+{
+    return key == other.key && title == other.title && subtitle == other.subtitle &&
+        tooltip == other.tooltip && keywords == other.keywords && state == other.state &&
+        graph.cacheKey() == other.graph.cacheKey();
+}
+
+ItemListModel::ItemListModel(QObject *parent)
+             : QAbstractListModel(parent)
+{
+}
+
+int
+ItemListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_query.isEmpty() ? m_items.size() : m_shown.size();
+}
+
+QVariant
+ItemListModel::data(const QModelIndex &index, int role) const
+{
+    int i = itemIndex(index.row());
+    if (!index.isValid() || i == -1) return QVariant();
+    const Item &item = m_items[i];
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return item.title;
+    case Qt::ToolTipRole:
+        return item.tooltip;
+    case Qt::DecorationRole:
+        return item.graph;
+    case KeyRole:
+        return item.key;
+    case SubtitleRole:
+        return item.subtitle;
+    case StateRole:
+        return item.state;
+    }
+    return QVariant();
+}
+
+void
+ItemListModel::setItems(const QList<Item> &items)
+{
+    beginResetModel();
+    m_items = items;
+    rebuildIndex();
+    applyFilter(false);
+    endResetModel();
+}
+
+void
+ItemListModel::updateItems(const QList<Item> &items)
+{
+    //Filtered: items are replaced at once, only visible rows are reconciled
+    if (!m_query.isEmpty())
+    {
+        QStringList shown_keys, changed_keys;
+        foreach (int i, m_shown)
+            shown_keys << m_items[i].key;
+        foreach (const Item &item, items)
+        {
+            int i = m_rows.value(item.key, -1);
+            if (i != -1 && m_items[i] != item) changed_keys << item.key;
+        }
+        m_items = items;
+        rebuildIndex();
+        m_shown.clear();
+        foreach (const QString &key, shown_keys)
+            m_shown << m_rows.value(key, -1); //-1: gone, removed first
+        updateShown();
+        foreach (const QString &key, changed_keys)
+            rowChanged(m_rows[key]);
+        return;
+    }
+
+    //Remove items that are gone (from the end, rows before stay valid)
+    QSet<QString> keys;
+    foreach (const Item &item, items)
+        keys << item.key;
+    for (int i = m_items.size() - 1; i >= 0; i--)
+    {
+        if (keys.contains(m_items[i].key)) continue;
+        beginRemoveRows(QModelIndex(), i, i);
+        m_items.removeAt(i);
+        endRemoveRows();
+    }
+
+    //Rows before i are done, the rest of the old items follows
+    QSet<QString> old_keys;
+    foreach (const Item &item, m_items)
+        old_keys << item.key;
+    for (int i = 0, ii = items.size(); i < ii; i++)
+    {
+        const Item &item = items[i];
+        if (i < m_items.size() && m_items[i].key == item.key)
+        {
+            //Same position, usually the case
+        }
+        else if (old_keys.contains(item.key))
+        {
+            //Moved (linear search, rare)
+            int from = i + 1;
+            while (m_items[from].key != item.key) from++;
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            m_items.move(from, i);
+            endMoveRows();
+        }
+        else
+        {
+            beginInsertRows(QModelIndex(), i, i);
+            m_items.insert(i, item);
+            endInsertRows();
+            continue;
+        }
+        if (m_items[i] != item)
+        {
+            m_items[i] = item;
+            rowChanged(i);
+        }
+    }
+
+    rebuildIndex();
+}
+
+void
+ItemListModel::appendItem(const Item &item)
+{
+    if (!m_query.isEmpty())
+    {
+        //Last item, so a match is also the last row
+        int i = m_items.size();
+        m_items.append(item);
+        m_rows.insert(item.key, i);
+        m_search.append(searchText(item));
+        if (!fuzzyMatch(m_search[i], m_query)) return;
+        beginInsertRows(QModelIndex(), m_shown.size(), m_shown.size());
+        m_shown.append(i);
+        endInsertRows();
+        return;
+    }
+
+    int row = m_items.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_items.append(item);
+    m_rows.insert(item.key, row);
+    m_search.append(searchText(item));
+    endInsertRows();
+}
+
+void
+ItemListModel::removeItem(const QString &key)
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1) return;
+    if (!m_query.isEmpty())
+    {
+        //Row only if shown, indexes after i move up
+        int row = this->row(key);
+        if (row != -1) beginRemoveRows(QModelIndex(), row, row);
+        m_items.removeAt(i);
+        rebuildIndex();
+        if (row != -1) m_shown.remove(row);
+        for (int r = 0, rr = m_shown.size(); r < rr; r++)
+            if (m_shown[r] > i) m_shown[r]--;
+        if (row != -1) endRemoveRows();
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), i, i);
+    m_items.removeAt(i);
+    rebuildIndex(); //rows after the removed one have moved
+    endRemoveRows();
+}
+
+int
+ItemListModel::row(const QString &key) const
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1 || m_query.isEmpty()) return i;
+    QVector<int>::const_iterator it = std::lower_bound(m_shown.constBegin(), m_shown.constEnd(), i);
+    if (it == m_shown.constEnd() || *it != i) return -1; //filtered out
+    return it - m_shown.constBegin();
+}
+
+ItemListModel::Item
+ItemListModel::item(const QString &key) const
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1) return Item();
+    return m_items[i];
+}
+
+QString
+ItemListModel::key(const QModelIndex &index) const
+{
+    int i = itemIndex(index.row());
+    if (!index.isValid() || i == -1) return QString();
+    return m_items[i].key;
+}
+
+void
+ItemListModel::setTitle(const QString &key, const QString &title)
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1 || m_items[i].title == title) return;
+    m_items[i].title = title;
+    m_search[i] = searchText(m_items[i]);
+    if (!m_query.isEmpty())
+    {
+        //May match the filter now, or not anymore
+        QVector<int>::iterator it = std::lower_bound(m_shown.begin(), m_shown.end(), i);
+        int row = it - m_shown.begin();
+        bool shown = it != m_shown.end() && *it == i;
+        bool match = fuzzyMatch(m_search[i], m_query);
+        if (match && !shown)
+        {
+            beginInsertRows(QModelIndex(), row, row);
+            m_shown.insert(row, i);
+            endInsertRows();
+            return;
+        }
+        if (!match && shown)
+        {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_shown.remove(row);
+            endRemoveRows();
+            return;
+        }
+    }
+    rowChanged(i);
+}
+
+void
+ItemListModel::setSubtitle(const QString &key, const QString &subtitle)
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1 || m_items[i].subtitle == subtitle) return;
+    m_items[i].subtitle = subtitle;
+    rowChanged(i);
+}
+
+void
+ItemListModel::setToolTip(const QString &key, const QString &tooltip)
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1 || m_items[i].tooltip == tooltip) return;
+    m_items[i].tooltip = tooltip;
+    rowChanged(i);
+}
+
+void
+ItemListModel::setState(const QString &key, int state)
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1 || m_items[i].state == state) return;
+    m_items[i].state = state;
+    rowChanged(i);
+}
+
+void
+ItemListModel::setGraph(const QString &key, const QPixmap &graph)
+{
+    int i = m_rows.value(key, -1);
+    if (i == -1 || m_items[i].graph.cacheKey() == graph.cacheKey()) return;
+    m_items[i].graph = graph;
+    rowChanged(i);
+}
+
+void
+ItemListModel::setFilter(const QString &text)
+{
+    //Whitespace is ignored
+    QString query = text.toLower();
+    query.remove(QRegularExpression("\\s"));
+    if (query == m_query) return;
+
+    //Longer query: matches are a subset of the previous matches
+    bool narrow = !m_query.isEmpty() && query.startsWith(m_query);
+    beginResetModel();
+    m_query = query;
+    applyFilter(narrow);
+    endResetModel();
+}
+
+QString
+ItemListModel::filter() const
+{
+    return m_query;
+}
+
+bool
+ItemListModel::fuzzyMatch(const QString &text, const QString &query)
+{
+    const QChar *t = text.constData(), *t_end = t + text.size();
+    const QChar *q = query.constData(), *q_end = q + query.size();
+    for (; q != q_end; ++q)
+    {
+        while (t != t_end && *t != *q) ++t;
+        if (t == t_end) return false;
+        ++t;
+    }
+    return true;
+}
+
+QString
+ItemListModel::searchText(const Item &item)
+{
+    return QString("%1\n%2\n%3").arg(item.title, item.key, item.keywords).toLower();
+}
+
+void
+ItemListModel::applyFilter(bool narrow)
+{
+    if (m_query.isEmpty())
+    {
+        m_shown.clear();
+        return;
+    }
+
+    QVector<int> shown;
+    if (narrow)
+    {
+        shown.reserve(m_shown.size());
+        foreach (int i, m_shown)
+            if (fuzzyMatch(m_search[i], m_query)) shown.append(i);
+    }
+    else
+    {
+        for (int i = 0, ii = m_search.size(); i < ii; i++)
+            if (fuzzyMatch(m_search[i], m_query)) shown.append(i);
+    }
+    m_shown = shown;
+}
+
+void
+ItemListModel::updateShown()
+{
+    //Target: all matches, in item order
+    QVector<int> shown;
+    for (int i = 0, ii = m_search.size(); i < ii; i++)
+        if (fuzzyMatch(m_search[i], m_query)) shown.append(i);
+    QSet<int> keep;
+    foreach (int i, shown)
+        keep << i;
+
+    //Remove rows that don't match (from the end, rows before stay valid)
+    for (int row = m_shown.size() - 1; row >= 0; row--)
+    {
+        if (keep.contains(m_shown[row])) continue;
+        beginRemoveRows(QModelIndex(), row, row);
+        m_shown.remove(row);
+        endRemoveRows();
+    }
+
+    //Same as updateItems(), on rows: moved or inserted
+    for (int row = 0, rows = shown.size(); row < rows; row++)
+    {
+        int i = shown[row];
+        if (row < m_shown.size() && m_shown[row] == i) continue;
+        int from = m_shown.indexOf(i, row + 1);
+        if (from != -1)
+        {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+            m_shown.move(from, row);
+            endMoveRows();
+        }
+        else
+        {
+            beginInsertRows(QModelIndex(), row, row);
+            m_shown.insert(row, i);
+            endInsertRows();
+        }
+    }
+}
+
+int
+ItemListModel::itemIndex(int row) const
+{
+    if (m_query.isEmpty())
+        return row >= 0 && row < m_items.size() ? row : -1;
+    return row >= 0 && row < m_shown.size() ? m_shown[row] : -1;
+}
+
+void
+ItemListModel::rowChanged(int item_index)
+{
+    //Item may be filtered out
+    int row = m_query.isEmpty() ? item_index : this->row(m_items[item_index].key);
+    if (row == -1) return;
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx);
+}
+
+void
+ItemListModel::rebuildIndex()
+{
+    m_rows.clear();
+    m_rows.reserve(m_items.size());
+    m_search.resize(m_items.size());
+    for (int i = 0, ii = m_items.size(); i < ii; i++)
+    {
+        m_rows.insert(m_items[i].key, i);
+        m_search[i] = searchText(m_items[i]);
+    }
+}
+
+ItemDelegate::ItemDelegate(QObject *parent)
+            : QStyledItemDelegate(parent),
+              m_menu_indicator(false)
+{
+    //Title font (big text), see ItemButton
+    m_fnt_title.setFamily("Monospace");
+    m_fnt_title.setStyleHint(QFont::TypeWriter);
+    m_fnt_title.setPointSize(14);
+    m_fnt_title.setWeight(QFont::Bold);
+
+    //Default colors, see ItemButton
+    setStateColors(0, QColor("lightGray"), QColor("black"), QColor("darkGray"), QColor("white"));
+}
+
+void
+ItemDelegate::setStateColors(int state, QColor bg, QColor fg, QColor hover_bg, QColor hover_fg)
+{
+    //Prepared once, not per paint
+    Colors colors;
+    colors.pal = QApplication::palette();
+    colors.pal.setColor(QPalette::Window, bg);
+    colors.pal.setColor(QPalette::WindowText, fg);
+    colors.pal_hover = QApplication::palette();
+    colors.pal_hover.setColor(QPalette::Window, hover_bg);
+    colors.pal_hover.setColor(QPalette::WindowText, hover_fg);
+    m_colors[state] = colors;
+}
+
+void
+ItemDelegate::setMenuIndicator(bool enabled)
+{
+    m_menu_indicator = enabled;
+}
+
+void
+ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    painter->save();
+
+    //Colors by state, hover from view (no model change)
+    QRect rect = option.rect.adjusted(0, 0, 0, -s_spacing);
+    int state = index.data(ItemListModel::StateRole).toInt();
+    QHash<int, Colors>::const_iterator it = m_colors.constFind(state);
+    if (it == m_colors.constEnd()) it = m_colors.constFind(0);
+    bool hover = option.state & QStyle::State_MouseOver;
+    const QPalette &pal = hover ? it.value().pal_hover : it.value().pal;
+    QColor fg = pal.color(QPalette::WindowText);
+
+    //Raised panel
+    qDrawShadePanel(painter, rect, pal, false, s_line_width, &pal.brush(QPalette::Window));
+
+    //Title, subtitle below
+    QRect content = rect.adjusted(s_margin, s_margin, -s_margin, -s_margin);
+    if (m_menu_indicator)
+        content.setRight(menuRect(option.rect).left());
+
+    //Graph (cached pixmap) at the right, vertically centered
+    QPixmap graph = qvariant_cast<QPixmap>(index.data(Qt::DecorationRole));
+    if (!graph.isNull())
+    {
+        QSize size = graphSize();
+        QRect graph_rect(content.right() - size.width(), content.center().y() - size.height() / 2, size.width(), size.height());
+        painter->drawPixmap(graph_rect, graph);
+        content.setRight(graph_rect.left() - s_margin);
+    }
+    painter->setPen(fg);
+    QFontMetrics fm_title(m_fnt_title);
+    QString title = fm_title.elidedText(index.data(Qt::DisplayRole).toString(), Qt::ElideRight, content.width());
+    painter->setFont(m_fnt_title);
+    painter->drawText(content, Qt::AlignLeft | Qt::AlignTop, title);
+    QString subtitle = index.data(ItemListModel::SubtitleRole).toString();
+    if (!subtitle.isEmpty())
+    {
+        QFontMetrics fm(option.font);
+        QRect sub_rect = content.adjusted(0, fm_title.height(), 0, 0);
+        painter->setFont(option.font);
+        painter->drawText(sub_rect, Qt::AlignLeft | Qt::AlignTop, fm.elidedText(subtitle, Qt::ElideRight, sub_rect.width()));
+    }
+
+    //Functions "..."
+    if (m_menu_indicator)
+    {
+        painter->setFont(option.font);
+        painter->drawText(menuRect(option.rect), Qt::AlignCenter, "...");
+    }
+
+    painter->restore();
+}
+
+QSize
+ItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    //Same for all items, room for a subtitle
+    Q_UNUSED(index);
+    int height = QFontMetrics(m_fnt_title).height() + QFontMetrics(option.font).height();
+    height += 2 * s_margin + s_spacing;
+    return QSize(option.rect.width(), height);
+}
+
+QSize
+ItemDelegate::graphSize()
+{
+    return QSize(96, 24);
+}
+
+QRect
+ItemDelegate::menuRect(const QRect &item_rect) const
+{
+    QRect rect = item_rect.adjusted(0, 0, 0, -s_spacing);
+    rect.setLeft(rect.right() - 40);
+    return rect;
+}
+
+ItemListView::ItemListView(ItemListModel *model, QWidget *parent)
+            : QListView(parent),
+              m_model(model)
+{
+    m_delegate = new ItemDelegate(this);
+    setModel(m_model);
+    setItemDelegate(m_delegate);
+
+    //Only visible rows are laid out and painted
+    setUniformItemSizes(true);
+    setLayoutMode(QListView::Batched);
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setSelectionMode(QAbstractItemView::NoSelection);
+    setFocusPolicy(Qt::NoFocus);
+
+    //Hover is painted by the delegate
+    setMouseTracking(true);
+    viewport()->setAttribute(Qt::WA_Hover);
+    viewport()->setCursor(Qt::PointingHandCursor);
+
+    setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(this, SIGNAL(customContextMenuRequested(const QPoint&)), SLOT(showContextMenu(const QPoint&)));
+}
+
+ItemListModel*
+ItemListView::itemModel() const
+{
+    return m_model;
+}
+
+ItemDelegate*
+ItemListView::itemDelegate() const
+{
+    return m_delegate;
+}
+
+void
+ItemListView::mouseReleaseEvent(QMouseEvent *event)
+{
+    QModelIndex index = indexAt(event->pos());
+    if (event->button() == Qt::LeftButton && index.isValid())
+    {
+        QString key = m_model->key(index);
+        QRect menu_rect = m_delegate->menuRect(visualRect(index));
+        if (menu_rect.contains(event->pos()))
+            emit menuRequested(key, viewport()->mapToGlobal(event->pos()));
+        else
+            emit itemClicked(key);
+    }
+
+    QListView::mouseReleaseEvent(event);
+}
+
+void
+ItemListView::showContextMenu(const QPoint &pos)
+{
+    QModelIndex index = indexAt(pos);
+    if (!index.isValid()) return;
+    emit menuRequested(m_model->key(index), viewport()->mapToGlobal(pos));
+}
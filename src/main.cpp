@@ -3,16 +3,37 @@
 
 int main(int argc, char *argv[])
 {
+    //Startup phases are timed from here (--profile-startup)
+    StartupProfile *profile = StartupProfile::globalInstance();
+    for (int i = 1; i < argc; i++)
+        if (QString(argv[i]) == "--profile-startup") profile->setEnabled(true);
+    profile->setBudget("tray ready", 100);
+    profile->setBudget("window built", 250);
+
     QApplication app(argc, argv);
     app.setOrganizationName("c0xc");
     app.setApplicationName(PROGRAM);
+    app.setQuitOnLastWindowClosed(false); //tray icon, see MainWindow::quit()
     QString program = QString(PROGRAM).toLower();
     SettingsManager::setInitVariantPrefix(true);
+    SettingsManager::setInitBinaryCache(true);
     SettingsManager::setDefaultGroup("main");
+    profile->mark("application");
+
+    //Settings access benchmark, no gui
+    if (app.arguments().contains("--bench-settings"))
+        return SettingsBenchmark::run();
 
+    //Tray first, the window is built when it's shown
+    //Started in the tray (window not built at all) with --hidden or start_hidden
     MainWindow *gui = 0;
     gui = new MainWindow;
-    gui->show();
+    profile->mark("main window");
+    bool hidden = app.arguments().contains("--hidden") ||
+        MountSettings::globalInstance()->variant("start_hidden").toBool();
+    if (!hidden || !QSystemTrayIcon::isSystemTrayAvailable())
+        QTimer::singleShot(0, gui, SLOT(show()));
+    QTimer::singleShot(0, profile, SLOT(report()));
 
     int code = app.exec();
     delete gui;
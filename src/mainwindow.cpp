@@ -1,11 +1,101 @@
 #include "mainwindow.hpp"
 
 MainWindow::MainWindow(QWidget *parent)
-          : QDialog(parent)
+          : QDialog(parent),
+            m_mdl_mounts(0),
+            m_lst_mounts(0),
+            m_btn_empty(0),
+            m_txt_filter(0),
+            m_tray_grouped(false),
+            m_reload_asking(false)
 {
     //This is the main control window, where all configured mounts are listed.
     //One-time actions are in the settings window, not in the main window.
+    //Only the tray icon is set up here. The window is built when it's
+    //shown for the first time (see buildWindow()), background work starts
+    //once the event loop is running (see startBackground()).
+    StartupProfile *profile = StartupProfile::globalInstance();
+    setWindowFlags(Qt::Window | Qt::CustomizeWindowHint | Qt::WindowTitleHint | Qt::WindowSystemMenuHint | Qt::WindowMinimizeButtonHint | Qt::WindowCloseButtonHint);
 
+    //Load window dimensions from settings
+    //Default settings group "main" set in main routine (main.cpp)
+    MountSettings *settings = getSettings();
+    //SettingsManager *settings = getSettings();
+    m_key_size = settings->compileKey("size");
+    m_key_pos = settings->compileKey("pos");
+    resize(settings->variant(m_key_size, QSize(400, 400)).toSize());
+    move(settings->variant(m_key_pos, QPoint(200, 200)).toPoint());
+    profile->mark("settings");
+
+    //System tray icon
+    QIcon ico(":/res/folderblack_3.png");
+    m_tray_icon = new QSystemTrayIcon(ico);
+    m_tray_icon->setToolTip(qApp->applicationName());
+    m_mnu_tray = new QMenu;
+    m_tray_icon->setContextMenu(m_mnu_tray);
+    connect(this, SIGNAL(mountStateChanged(const QString&)), SLOT(updateTrayMenu(const QString&)));
+    connect(m_tray_icon, SIGNAL(activated(QSystemTrayIcon::ActivationReason)), SLOT(iconActivated(QSystemTrayIcon::ActivationReason)));
+    connect(m_tray_icon, SIGNAL(messageClicked()), SLOT(showEventLog()));
+
+    //Messages batched (many mounts at once), details in the event log
+    m_notifications = new NotificationAggregator(m_tray_icon, this);
+    m_notifications->setDelay(settings->variant("notify_delay", 1500).toInt());
+
+    //Load saved mounts, initialize tray menu (and list, once built)
+    initConnections();
+    m_tray_icon->setVisible(true);
+    profile->mark("tray ready");
+
+    //Redraw what has been changed, by the settings window or another program
+    settings->subscribe("mount_list", this, SLOT(mountListChanged()));
+    settings->subscribe("mount_list", this, SLOT(updateTrayMenu()));
+
+    //Space usage of remotes, fetched in the background and cached
+    RemoteUsage *usage = RemoteUsage::globalInstance();
+    usage->setTimeToLive(settings->variant("usage_ttl", 600).toInt());
+    usage->setMaxRunning(settings->variant("usage_concurrency", 4).toInt());
+    connect(usage, SIGNAL(usageChanged(const QString&)), SLOT(usageChanged(const QString&)));
+
+    //Throughput of active mounts, polled while the window is visible
+    MountStats *stats = MountStats::globalInstance();
+    stats->setInterval(settings->variant("stats_interval", 2000).toInt());
+    connect(stats, SIGNAL(statsChanged(const QString&)), SLOT(statsChanged(const QString&)));
+
+    //Reachability of remotes, checked before mounting on startup
+    RemoteHealth *health = RemoteHealth::globalInstance();
+    health->setTimeToLive(settings->variant("health_ttl", 300).toInt());
+    health->setMaxRunning(settings->variant("health_concurrency", 8).toInt());
+    health->setTimeout(settings->variant("health_timeout", 15000).toInt());
+    connect(health, SIGNAL(healthChanged(const QString&)), SLOT(healthChanged(const QString&)));
+
+    //Reload config file after changes by other programs, see startBackground()
+    m_config_watcher = 0;
+    m_tmr_reload.setSingleShot(true);
+    m_tmr_reload.setInterval(200);
+    connect(&m_tmr_reload, SIGNAL(timeout()), SLOT(reloadConfig()));
+    connect(&m_reload_watcher, SIGNAL(finished()), SLOT(configReloaded()));
+
+    //Refresh usage of remotes when outdated (started with the window)
+    m_tmr_usage.setInterval(60000);
+    connect(&m_tmr_usage, SIGNAL(timeout()), SLOT(requestUsage()));
+
+    QTimer::singleShot(0, this, SLOT(startBackground()));
+
+}
+
+void
+MainWindow::setVisible(bool visible)
+{
+    //Built on first show, not on startup
+    if (visible && !m_lst_mounts)
+        buildWindow();
+
+    QDialog::setVisible(visible);
+}
+
+void
+MainWindow::buildWindow()
+{
     //Main layout
     QVBoxLayout *vbox = new QVBoxLayout;
     #if true
@@ -15,21 +105,40 @@ MainWindow::MainWindow(QWidget *parent)
     main->setLayout(vbox);
     setCentralWidget(main);
     #endif
-    setWindowFlags(Qt::Window | Qt::CustomizeWindowHint | Qt::WindowTitleHint | Qt::WindowSystemMenuHint | Qt::WindowMinimizeButtonHint | Qt::WindowCloseButtonHint);
 
     //Title area
     QLabel *lbl_heading = new QLabel("RCLONE CONTROL");
     vbox->addWidget(lbl_heading);
 
-    //Main frame (haha)
-    m_frm_conns = new QFrame;
-    QSizePolicy size_frm_conns = m_frm_conns->sizePolicy();
-    m_frm_conns->setFrameStyle(QLabel::StyledPanel | QLabel::Plain);
+    //Filter (label, connection, mountpoint), Enter acts on a single match
+    m_txt_filter = new QLineEdit;
+    m_txt_filter->setPlaceholderText(tr("Filter..."));
+    m_txt_filter->setClearButtonEnabled(true);
+    connect(m_txt_filter, SIGNAL(textChanged(const QString&)), SLOT(filterMounts(const QString&)));
+    connect(m_txt_filter, SIGNAL(returnPressed()), SLOT(actFilterMatch()));
+    vbox->addWidget(m_txt_filter);
+
+    //Main list (one item per mount, only visible items are painted)
+    m_mdl_mounts = new ItemListModel(this);
+    m_lst_mounts = new ItemListView(m_mdl_mounts);
+    QSizePolicy size_lst_mounts = m_lst_mounts->sizePolicy();
     //horizontalPolicy = QSizePolicy::Preferred, verticalPolicy = QSizePolicy::MinimumExpanding
-    size_frm_conns.setVerticalPolicy(QSizePolicy::MinimumExpanding);
-    m_frm_conns->setSizePolicy(size_frm_conns);
-    //m_frm_conns->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    vbox->addWidget(m_frm_conns);
+    size_lst_mounts.setVerticalPolicy(QSizePolicy::MinimumExpanding);
+    m_lst_mounts->setSizePolicy(size_lst_mounts);
+    ItemDelegate *delegate = m_lst_mounts->itemDelegate();
+    delegate->setMenuIndicator(true);
+    delegate->setStateColors(0, QColor("lightGray"), QColor("black"), QColor("limegreen"), QColor("crimson")); //connect
+    delegate->setStateColors(1, QColor("limegreen"), QColor("black"), QColor("crimson"), QColor("limegreen")); //disconnect
+    connect(m_lst_mounts, SIGNAL(itemClicked(const QString&)), SLOT(actButton(const QString&)));
+    connect(m_lst_mounts, SIGNAL(menuRequested(const QString&, const QPoint&)), SLOT(showMountMenu(const QString&, const QPoint&)));
+    vbox->addWidget(m_lst_mounts);
+
+    //Shown instead of the list if there are no mounts
+    m_btn_empty = new ItemButton(tr("(No mounts configured yet...)"));
+    m_btn_empty->setLineWidth(2);
+    connect(m_btn_empty, SIGNAL(clicked()), SLOT(openSettings()));
+    vbox->addWidget(m_btn_empty);
+    vbox->addStretch();
 
     //Buttons at the bottom
     QHBoxLayout *hbox_btns = new QHBoxLayout;
@@ -39,28 +148,34 @@ MainWindow::MainWindow(QWidget *parent)
     hbox_btns->addStretch();
     QPushButton *btn_quit = new QPushButton(tr("&Quit"));
     hbox_btns->addWidget(btn_quit);
+    connect(btn_quit, SIGNAL(clicked()), SLOT(quit()));
     vbox->addLayout(hbox_btns);
 
-    //System tray icon
-    QIcon ico(":/res/folderblack_3.png");
-    m_tray_icon = new QSystemTrayIcon(ico);
-    m_tray_icon->setToolTip(qApp->applicationName());
-    m_tray_icon->setVisible(true);
-    m_mnu_tray = new QMenu;
-    m_tray_icon->setContextMenu(m_mnu_tray);
-    connect(this, SIGNAL(mountStateChanged(const QString&)), SLOT(updateTrayMenu(const QString&)));
-    connect(m_tray_icon, SIGNAL(activated(QSystemTrayIcon::ActivationReason)), SLOT(iconActivated(QSystemTrayIcon::ActivationReason)));
-
-    //Load window dimensions from settings
-    //Default settings group "main" set in main routine (main.cpp)
-    MountSettings *settings = getSettings();
-    //SettingsManager *settings = getSettings();
-    resize(settings->variant("size", QSize(400, 400)).toSize());
-    move(settings->variant("pos", QPoint(200, 200)).toPoint());
-
-    //Load saved mounts, initialize list
-    initConnections();
+    //Fill list, items request usage of their remotes
+    loadConnections(m_mount_list);
+    m_tmr_usage.start();
+    StartupProfile::globalInstance()->mark("window built");
+}
 
+void
+MainWindow::startBackground()
+{
+    //Watch config file for changes by other programs
+    //The directory is watched too because the file is replaced on save.
+    m_config_watcher = new QFileSystemWatcher(this);
+    QFileInfo config_file = getSettings()->configFileInfo();
+    m_config_watcher->addPath(config_file.absolutePath());
+    if (config_file.exists())
+        m_config_watcher->addPath(config_file.filePath());
+    connect(m_config_watcher, SIGNAL(fileChanged(const QString&)), SLOT(configFileChanged()));
+    connect(m_config_watcher, SIGNAL(directoryChanged(const QString&)), SLOT(configFileChanged()));
+
+    //Read rclone.conf in the background, needed by the settings window
+    RemoteCatalog::globalInstance()->refresh();
+
+    //Mount on startup
+    autoMount();
+    StartupProfile::globalInstance()->mark("background started");
 }
 
 void
@@ -70,20 +185,74 @@ MainWindow::openSettings()
     //connect(settings_window, SIGNAL(saved()), SLOT(saveSettings()));
     settings_window->setModal(true);
     settings_window->exec();
-    QList<QVariantMap> conns = settings_window->result();
-    initConnections();
+    delete settings_window;
+    //Changes are applied in mountListChanged()
+}
+
+void
+MainWindow::openBenchmark()
+{
+    QAction *action = qobject_cast<QAction*>(QObject::sender());
+    if (!action) return;
+    QString mountpoint = action->data().toString();
+    if (mountpoint.isEmpty()) return;
+
+    //Non-modal, the benchmark may take a while
+    BenchmarkWindow *benchmark_window = new BenchmarkWindow(getSettings(), mountpoint, this);
+    connect(benchmark_window, SIGNAL(mountCreated(MountControl*)), SLOT(watchMount(MountControl*)));
+    benchmark_window->show();
 }
 
 void
 MainWindow::closeEvent(QCloseEvent *event)
 {
+    //Closing the window quits the program, mounts are handled in quit()
+    event->ignore();
+    quit();
+}
+
+void
+MainWindow::quit()
+{
+    if (m_shutdown) return; //already quitting
+
     //Default settings group "main" set in main routine (main.cpp)
     MountSettings *settings = getSettings();
-    settings->setVariant("size", size());
-    settings->setVariant("pos", pos());
+    if (isVisible())
+    {
+        settings->setVariant(m_key_size, size());
+        settings->setVariant(m_key_pos, pos());
+    }
+
+    //Shutdown policy: "unmount", "keep" or ask (default)
+    ShutdownCoordinator::Policy policy = ShutdownCoordinator::UnmountAll;
+    QString policy_name = settings->variant("shutdown_policy").toString();
+    if (policy_name == "keep")
+    {
+        policy = ShutdownCoordinator::KeepMounts;
+    }
+    else if (policy_name != "unmount" && !MountControl::activeControls().isEmpty())
+    {
+        QMessageBox msg_box(QMessageBox::Question, tr("Quit"),
+            tr("Some mountpoints are active. Unmount them or keep them running?"),
+            QMessageBox::NoButton, this);
+        QPushButton *btn_umount = msg_box.addButton(tr("&Unmount all"), QMessageBox::AcceptRole);
+        QPushButton *btn_keep = msg_box.addButton(tr("&Keep mounted"), QMessageBox::RejectRole);
+        msg_box.addButton(QMessageBox::Cancel);
+        msg_box.exec();
+        if (msg_box.clickedButton() == btn_keep)
+            policy = ShutdownCoordinator::KeepMounts;
+        else if (msg_box.clickedButton() != btn_umount)
+            return;
+    }
 
     saveSettings();
-    event->accept();
+
+    //Unmount concurrently, bounded by deadline
+    int deadline = settings->variant("shutdown_deadline", 30000).toInt();
+    m_shutdown = new ShutdownCoordinator(policy, deadline, this);
+    connect(m_shutdown.data(), SIGNAL(finished()), qApp, SLOT(quit()));
+    m_shutdown->start();
 }
 
 void
@@ -116,47 +285,236 @@ MainWindow::changeEvent(QEvent* e)
 }
 
 void
-MainWindow::loadConnections(QList<QVariantMap> conn_list)
+MainWindow::showEvent(QShowEvent *event)
+{
+    MountStats::globalInstance()->setActive(true);
+    QDialog::showEvent(event);
+}
+
+void
+MainWindow::hideEvent(QHideEvent *event)
+{
+    MountStats::globalInstance()->setActive(false);
+    QDialog::hideEvent(event);
+}
+
+void
+MainWindow::statsChanged(const QString &mountpoint)
+{
+    if (!m_mdl_mounts) return;
+
+    //Only this row is repainted, the pixmap is rendered once per sample
+    QPixmap graph = MountStats::globalInstance()->sparkline(mountpoint, ItemDelegate::graphSize(), QColor("navy"));
+    m_mdl_mounts->setGraph(mountpoint, graph);
+}
+
+void
+MainWindow::loadConnections(QList<MountConfig> conn_list)
+{
+    m_mount_list = conn_list;
+    if (!m_mdl_mounts) return; //not built yet
+
+    //Import/load configured connections in list
+    //Only rows that differ are changed (matched by mountpoint).
+    QSet<QString> active;
+    foreach (QString mountpoint, MountControl::activeMountpoints())
+        active << mountpoint;
+    QList<ItemListModel::Item> items;
+    foreach (const MountConfig &cfg, conn_list)
+        items << mountItem(cfg, active.contains(cfg.mountpoint));
+    m_mdl_mounts->updateItems(items);
+
+    m_lst_mounts->setVisible(!conn_list.isEmpty());
+    m_btn_empty->setVisible(conn_list.isEmpty());
+}
+
+ItemListModel::Item
+MainWindow::mountItem(const MountConfig &conn_config, bool connected)
+{
+    //Mountpoint used to identify config item
+    ItemListModel::Item item;
+    item.key = conn_config.mountpoint;
+    item.title = conn_config.title();
+    item.state = connected ? 1 : 0;
+    item.keywords = conn_config.connection + ":" + conn_config.remote_path;
+    item.tooltip = item.state ? tr("Unmount: %1").arg(item.key) : tr("Mount: %1").arg(item.key);
+    RemoteUsageInfo usage = RemoteUsage::globalInstance()->usage(conn_config.connection);
+    if (usage.isValid())
+        item.subtitle = usage.summary();
+    RemoteUsage::globalInstance()->request(conn_config.connection); //if outdated
+    item.graph = MountStats::globalInstance()->sparkline(item.key, ItemDelegate::graphSize(), QColor("navy")); //cached
+    return item;
+}
+
+void
+MainWindow::applyMountChanges(const QList<MountConfig> &old_list, const QList<MountConfig> &new_list)
+{
+    QStringList added, removed, changed;
+    MountSettings::diffMountConfigList(old_list, new_list, &added, &removed, &changed);
+    if (added.isEmpty() && removed.isEmpty() && changed.isEmpty()) return;
+
+    //Added, removed and changed rows (also order), see ItemListModel::updateItems()
+    loadConnections(new_list);
+
+    //Offer to stop removed mounts
+    QStringList active_removed;
+    foreach (QString mountpoint, removed)
+    {
+        if (isConnected(mountpoint)) active_removed << mountpoint;
+    }
+
+    foreach (QString mountpoint, active_removed)
+    {
+        if (QMessageBox::question(this, tr("Mountpoint removed"),
+            tr("This mountpoint has been removed from the configuration but it is still mounted. Unmount it now?\n%1").arg(mountpoint))
+            == QMessageBox::Yes)
+            umount(mountpoint);
+    }
+}
+
+void
+MainWindow::configFileChanged()
+{
+    //Saving replaces the file (rename), so watch it again
+    QString path = getSettings()->configFileInfo().filePath();
+    if (!m_config_watcher->files().contains(path) && QFileInfo::exists(path))
+        m_config_watcher->addPath(path);
+
+    //Wait for writes to settle, then reload
+    m_tmr_reload.start();
+}
+
+void
+MainWindow::reloadConfig()
+{
+    if (m_reload_watcher.isRunning())
+    {
+        m_tmr_reload.start(); //try again later
+        return;
+    }
+
+    //Read and parse in background
+    QString path = getSettings()->configFileInfo().filePath();
+    m_reload_watcher.setFuture(QtConcurrent::run(SettingsManager::readConfigFile, path));
+}
+
+void
+MainWindow::configReloaded()
 {
-    foreach (QObject *child, m_frm_conns->children()) //also see findChildren()
-        child->deleteLater();
-    QVBoxLayout *frm_vbox = new QVBoxLayout;
-    delete m_frm_conns->layout();
-    m_frm_conns->setLayout(frm_vbox);
-    m_btn_map.clear();
+    QVariantMap result = m_reload_watcher.result();
+    if (!result.value("ok").toBool()) return; //missing or broken file, keep current
 
-    //Import/load configured connections in frame
-    int s_connections_count = conn_list.size();
-    for (int i = 0; i < s_connections_count; ++i)
+    //Our own write (or no change)
+    MountSettings *settings = getSettings();
+    QByteArray hash = result["hash"].toByteArray();
+    if (hash == settings->fileHash()) return;
+
+    if (settings->setLoadedData(result["data"].toMap(), hash)) return; //see mountListChanged()
+
+    //Unsaved changes as well, save() won't overwrite the file: ask once
+    if (m_reload_asking) return;
+    m_reload_asking = true;
+    QMessageBox box(QMessageBox::Warning, tr("Configuration changed"),
+        tr("The configuration file has been changed by another program, "
+        "but there are unsaved changes."), QMessageBox::NoButton, this);
+    QPushButton *btn_reload = box.addButton(tr("&Reload file"), QMessageBox::DestructiveRole);
+    box.addButton(tr("&Keep my changes"), QMessageBox::AcceptRole);
+    box.exec();
+    m_reload_asking = false;
+    if (box.clickedButton() == btn_reload)
+    {
+        settings->setLoadedData(result["data"].toMap(), hash, true);
+    }
+    else
     {
-        QVariantMap conn_config = conn_list[i];
-        QString mountpoint = conn_config["mountpoint"].toString();
-        QString title = conn_config["label"].toString();
-        if (title.isEmpty())
-            title = conn_config["connection"].toString();
-        ItemButton *itm_btn = new ItemButton(title);
-        itm_btn->setSignalName(mountpoint); //mountpoint used to identify config item
-        itm_btn->setToolTip(mountpoint);
-        connect(itm_btn, SIGNAL(clicked(const QString&)), SLOT(actButton(const QString&)));
-        connect(itm_btn, SIGNAL(entered()), SLOT(updateButton()));
-        connect(itm_btn, SIGNAL(left()), SLOT(updateButton()));
-        frm_vbox->addWidget(itm_btn);
-        frm_vbox->addSpacing(5);
-        m_btn_map[mountpoint] = itm_btn;
+        settings->setFileHash(hash); //overwrite
+        settings->save();
+    }
+}
+
+void
+MainWindow::mountListChanged()
+{
+    applyMountChanges(m_mount_list, getSettings()->mounts());
+}
+
+void
+MainWindow::usageChanged(const QString &remote)
+{
+    if (!m_mdl_mounts) return;
+    RemoteUsageInfo info = RemoteUsage::globalInstance()->usage(remote);
+    if (!info.isValid()) return;
+    QString summary = info.summary();
+    foreach (const MountConfig &cfg, m_mount_list)
+    {
+        if (cfg.connection != remote) continue;
+        m_mdl_mounts->setSubtitle(cfg.mountpoint, summary);
+    }
+}
+
+void
+MainWindow::autoMount()
+{
+    RemoteHealth *health = RemoteHealth::globalInstance();
+    foreach (const MountConfig &cfg, getSettings()->mounts())
+    {
+        if (!cfg.auto_mount || isConnected(cfg.mountpoint)) continue;
+
+        //Probe remote first, unless it is known to work (or fail)
+        RemoteHealthInfo info = health->health(cfg.connection);
+        m_auto_mount_pending << cfg.mountpoint;
+        if (health->probe(cfg.connection) || health->isProbing(cfg.connection)) continue;
+        if (info.status == RemoteHealthInfo::Unknown)
+            info.status = RemoteHealthInfo::Ok; //not probed: local path or backend
+        m_auto_mount_pending.remove(cfg.mountpoint);
+        if (info.isFailing())
+        {
+            //Known to fail (cached), reported like a failed probe (see healthChanged())
+            QString title = tr("Not mounted: %1").arg(cfg.connection);
+            QString msg = tr("The connection %1 is not working (%2), skipped: %3").
+                arg(cfg.connection, info.summary(), cfg.mountpoint);
+            m_notifications->notify(QSystemTrayIcon::Warning, tr("skipped"), title, msg);
+        }
+        else
+        {
+            mount(cfg.mountpoint);
+        }
     }
+}
 
-    if (!s_connections_count)
+void
+MainWindow::healthChanged(const QString &remote)
+{
+    if (m_auto_mount_pending.isEmpty()) return;
+    RemoteHealthInfo info = RemoteHealth::globalInstance()->health(remote);
+
+    QStringList skipped;
+    foreach (QString mountpoint, m_auto_mount_pending.values())
     {
-        ItemButton *itm_btn = new ItemButton(tr("(No mounts configured yet...)"));
-        itm_btn->setLineWidth(2);
-        connect(itm_btn, SIGNAL(clicked()), SLOT(openSettings()));
-        frm_vbox->addWidget(itm_btn);
-        frm_vbox->addSpacing(5);
+        MountConfig cfg = getSettings()->mount(mountpoint);
+        if (cfg.connection != remote) continue;
+        m_auto_mount_pending.remove(mountpoint);
+        if (!cfg.auto_mount || isConnected(mountpoint)) continue;
+        if (info.isFailing())
+            skipped << mountpoint;
+        else
+            mount(mountpoint);
     }
 
-    frm_vbox->addStretch();
+    if (!skipped.isEmpty())
+    {
+        QString title = tr("Not mounted: %1").arg(remote);
+        QString msg = tr("The connection %1 is not working (%2), skipped: %3").
+            arg(remote, info.summary(), skipped.join(", "));
+        m_notifications->notify(QSystemTrayIcon::Warning, tr("skipped"), title, msg);
+    }
+}
 
-    updateTrayMenu(); //TODO get rid of list argument
+void
+MainWindow::requestUsage()
+{
+    foreach (const MountConfig &cfg, m_mount_list)
+        RemoteUsage::globalInstance()->request(cfg.connection);
 }
 
 void
@@ -164,48 +522,77 @@ MainWindow::initConnections()
 {
     MountSettings *settings = getSettings();
 
-    QList<QVariantMap> conn_list = settings->mountConfigList();
+    QList<MountConfig> conn_list = settings->mounts();
     loadConnections(conn_list);
+    updateTrayMenu();
 }
 
 void
 MainWindow::saveSettings()
 {
-    getSettings()->save();
+    getSettings()->flush();
 }
 
 void
 MainWindow::updateButton(const QString &mountpoint, int mode)
 {
-    if (mountpoint.isEmpty()) return;
-    QPointer<ItemButton> button = m_btn_map.value(mountpoint);
+    if (mountpoint.isEmpty() || !m_mdl_mounts) return;
 
+    //Colors per state are set on the delegate, only this row is repainted
+    //(if the state has changed, see ItemListModel::setState())
     if (mode == -1) mode = isConnected(mountpoint) ? 1 : 0;
+    m_mdl_mounts->setState(mountpoint, mode);
     if (!mode)
-    {
-        //Paint connect button
-        button->setHoverBgColor(QColor("limegreen"));
-        button->setHoverFgColor(QColor("crimson"));
-        //button->setBgColor(QColor("slateblue"));
-        button->resetBgColor();
-        button->setToolTip(tr("Mount: %1").arg(mountpoint));
-    }
+        m_mdl_mounts->setToolTip(mountpoint, tr("Mount: %1").arg(mountpoint));
     else
+        m_mdl_mounts->setToolTip(mountpoint, tr("Unmount: %1").arg(mountpoint));
+}
+
+void
+MainWindow::filterMounts(const QString &text)
+{
+    //Only rows change, the placeholder stays hidden
+    m_mdl_mounts->setFilter(text);
+}
+
+void
+MainWindow::actFilterMatch()
+{
+    if (m_mdl_mounts->rowCount() != 1) return;
+    actButton(m_mdl_mounts->key(m_mdl_mounts->index(0)));
+}
+
+void
+MainWindow::showFilter()
+{
+    show();
+    raise();
+    activateWindow();
+    m_txt_filter->setFocus();
+    m_txt_filter->selectAll();
+}
+
+void
+MainWindow::showEventLog()
+{
+    //One window, kept open
+    if (!m_wnd_event_log)
     {
-        //Paint disconnect button
-        button->setHoverBgColor(QColor("crimson"));
-        button->setHoverFgColor(QColor("limegreen"));
-        button->setBgColor(QColor("limegreen"));
-        button->setToolTip(tr("Unmount: %1").arg(mountpoint));
+        m_wnd_event_log = new EventLogWindow(m_notifications, this);
+        m_wnd_event_log->setAttribute(Qt::WA_DeleteOnClose);
     }
+    m_wnd_event_log->show();
+    m_wnd_event_log->raise();
 }
 
 void
-MainWindow::updateButton()
+MainWindow::showMountMenu(const QString &mountpoint, const QPoint &pos)
 {
-    ItemButton *button = qobject_cast<ItemButton*>(QObject::sender());
-    if (!button) return;
-    updateButton(button->signalName());
+    QMenu menu;
+    QAction *act_bench = menu.addAction(tr("Benchmark"));
+    act_bench->setData(mountpoint);
+    connect(act_bench, SIGNAL(triggered()), SLOT(openBenchmark()));
+    menu.exec(pos);
 }
 
 void
@@ -217,13 +604,6 @@ MainWindow::actButton(const QString &mountpoint)
     //Do NOT update button style before receiving signal confirmation
 }
 
-void
-MainWindow::actButton(ItemButton *button)
-{
-    QString mountpoint = button->signalName();
-    actButton(mountpoint);
-}
-
 void
 MainWindow::mount(const QString &mountpoint)
 {
@@ -231,23 +611,30 @@ MainWindow::mount(const QString &mountpoint)
     if (!mount)
     {
         //Create new mount object (reference will be saved on mount())
-        QVariantMap cfg = getSettings()->mountConfig(mountpoint);
-        QString conn = cfg["connection"].toString();
-        mount = MountControl::fromMountpoint(mountpoint, conn);
+        MountConfig cfg = getSettings()->mount(mountpoint);
+        mount = MountControl::fromMountpoint(mountpoint, cfg.connection);
         if (!mount) return; //error
-        connect(mount.data(), SIGNAL(mountedSignal(const QString&)), SLOT(mounted(const QString&)));
-        connect(mount.data(), SIGNAL(umountedSignal(const QString&, int, const QByteArray&)), SLOT(umounted(const QString&, int, const QByteArray&)));
+        mount->setRemotePath(cfg.remote_path);
+        mount->setExtraArguments(getSettings()->profileArguments(cfg.profile));
+        watchMount(mount.data());
     }
     mount->mount();
 }
 
+void
+MainWindow::watchMount(MountControl *mount)
+{
+    connect(mount, SIGNAL(mountedSignal(const QString&)), SLOT(mounted(const QString&)), Qt::UniqueConnection);
+    connect(mount, SIGNAL(umountedSignal(const QString&, int, const QByteArray&)), SLOT(umounted(const QString&, int, const QByteArray&)), Qt::UniqueConnection);
+}
+
 void
 MainWindow::umount(const QString &mountpoint)
 {
     QPointer<MountControl> mount = MountControl::fromMountpoint(mountpoint);
     if (!mount) return;
-    mount->umount();
-    mount->discard();
+    //Does not wait, see umounted()
+    mount->requestUmount();
 }
 
 void
@@ -283,10 +670,10 @@ MainWindow::mounted(const QString &mountpoint)
     //Paint active button
     updateButton(mountpoint, 1);
 
-    //Show notification
+    //Show notification (batched)
     QString title = tr("Mounted: %1").arg(mountpoint);
     QString msg = tr("This mountpoint has been activated.");
-    m_tray_icon->showMessage(title, msg);
+    m_notifications->notify(QSystemTrayIcon::Information, tr("mounted"), title, msg);
 }
 
 void
@@ -297,68 +684,185 @@ MainWindow::umounted(const QString &mountpoint, int rc, const QByteArray &err_ou
 
     //Paint default button
     updateButton(mountpoint, 0);
+    MountStats::globalInstance()->clear(mountpoint);
 
-    //Show error message, if any
+    //Normally discarded by now, unless rclone was terminated by a signal
+    QPointer<MountControl> mount = MountControl::fromMountpoint(mountpoint);
+    if (mount && !mount->isMounted())
+        mount->discard();
+
+    //Show error message, if any (batched)
     if (rc)
     {
-        //Show error as balloon tip
         QString title = tr("Error: %1").arg(mountpoint);
         QString msg = tr("The mount control process has returned an error.");
         if (!err_output.isEmpty())
             msg = err_output;
-        m_tray_icon->showMessage(title, msg, QSystemTrayIcon::Critical);
-        //Show message box if main window is active
+        m_notifications->notify(QSystemTrayIcon::Critical, tr("failed"), title, msg);
+        //Show details if main window is active (not modal, errors may come in bulk)
         if (isVisible())
-        {
-            QMessageBox::critical(this, title, msg);
-        }
+            showEventLog();
     }
     else
     {
         QString title = tr("Unmounted: %1").arg(mountpoint);
         QString msg = tr("This mountpoint was unmounted.");
-        m_tray_icon->showMessage(title, msg);
+        m_notifications->notify(QSystemTrayIcon::Information, tr("unmounted"), title, msg);
     }
 }
 
 void
 MainWindow::updateTrayMenu()
 {
-    //QMenu *menu = new QMenu;
+    //Mount actions are kept (by mountpoint) and patched in place,
+    //the menu is only rebuilt if its layout changes (order, grouping).
+    QList<MountConfig> list = getSettings()->mounts();
+    QSet<QString> active;
+    foreach (QString mountpoint, MountControl::activeMountpoints())
+        active << mountpoint;
+
+    //Large lists are grouped by remote, in submenus
+    int group_threshold = getSettings()->variant("tray_group_threshold", 20).toInt();
+    bool grouped = group_threshold > 0 && list.size() > group_threshold;
+
+    QSet<QString> mountpoints;
+    QStringList order, kept_order, old_order;
+    foreach (const MountConfig &cfg, list)
+    {
+        mountpoints << cfg.mountpoint;
+        order << cfg.mountpoint;
+        if (m_tray_actions.contains(cfg.mountpoint)) kept_order << cfg.mountpoint;
+    }
+    foreach (QString mountpoint, m_tray_order)
+        if (mountpoints.contains(mountpoint)) old_order << mountpoint;
+    if (!m_act_tray_end || grouped != m_tray_grouped || old_order != kept_order)
+        resetTrayMenu(grouped);
+
+    //Remove actions of removed mounts
+    foreach (QString mountpoint, m_tray_actions.keys())
+    {
+        if (mountpoints.contains(mountpoint)) continue;
+        QPointer<QAction> act = m_tray_actions.take(mountpoint);
+        if (!act) continue;
+        foreach (QWidget *widget, act->associatedWidgets())
+            widget->removeAction(act);
+        act->deleteLater();
+    }
+
+    if (!grouped)
+    {
+        //Backwards, each new action is inserted before its successor
+        QAction *next = m_act_tray_end;
+        for (int i = list.size() - 1; i >= 0; i--)
+        {
+            const MountConfig &cfg = list[i];
+            QAction *act = m_tray_actions.value(cfg.mountpoint);
+            if (!act)
+            {
+                act = createTrayAction(cfg.mountpoint);
+                m_mnu_tray->insertAction(next, act);
+            }
+            act->setText(cfg.title());
+            act->setChecked(active.contains(cfg.mountpoint));
+            next = act;
+        }
+    }
+    else
+    {
+        //New actions at the end of their group, moved if the remote has changed
+        foreach (const MountConfig &cfg, list)
+        {
+            QMenu *group = trayGroup(cfg.connection);
+            QAction *act = m_tray_actions.value(cfg.mountpoint);
+            if (!act)
+            {
+                act = createTrayAction(cfg.mountpoint);
+                group->addAction(act);
+            }
+            else if (!act->associatedWidgets().contains(group))
+            {
+                foreach (QWidget *widget, act->associatedWidgets())
+                    widget->removeAction(act);
+                group->addAction(act);
+            }
+            act->setText(cfg.title());
+            act->setChecked(active.contains(cfg.mountpoint));
+        }
+
+        //Remove empty groups
+        foreach (QString remote, m_tray_groups.keys())
+        {
+            QPointer<QMenu> group = m_tray_groups.value(remote);
+            if (group && !group->actions().isEmpty()) continue;
+            m_tray_groups.remove(remote);
+            if (group) group->deleteLater();
+        }
+    }
+
+    m_tray_order = order;
+}
+
+void
+MainWindow::resetTrayMenu(bool grouped)
+{
     QMenu *menu = m_mnu_tray;
+    foreach (QPointer<QAction> act, m_tray_actions)
+        if (act) act->deleteLater();
+    m_tray_actions.clear();
+    foreach (QPointer<QMenu> group, m_tray_groups)
+        if (group) group->deleteLater();
+    m_tray_groups.clear();
     foreach (QAction *act, menu->actions())
-        act->deleteLater();
+    {
+        menu->removeAction(act);
+        if (!act->menu()) act->deleteLater();
+    }
+    m_tray_order.clear();
+    m_tray_grouped = grouped;
+
     QAction *act = menu->addAction(tr("Open"));
     connect(act, SIGNAL(triggered()), SLOT(show()));
     connect(act, SIGNAL(triggered()), SLOT(raise()));
+    act = menu->addAction(tr("Find..."));
+    connect(act, SIGNAL(triggered()), SLOT(showFilter()));
+    act = menu->addAction(tr("Event log"));
+    connect(act, SIGNAL(triggered()), SLOT(showEventLog()));
     menu->addSeparator();
-    foreach (const QVariantMap &cfg, getSettings()->mountConfigList())
-    {
-        QString mountpoint = cfg["mountpoint"].toString();
-        QString title = cfg["label"].toString();
-        if (title.isEmpty())
-            title = cfg["connection"].toString();
-        act = menu->addAction(title);
-        act->setCheckable(true);
-        act->setChecked(isConnected(mountpoint));
-        act->setProperty("mountpoint", mountpoint);
-        connect(act, SIGNAL(triggered()), SLOT(switchConnection()));
-    }
-    menu->addSeparator();
-    //act = menu->addAction(tr("Quit"));
+    //Mounts go here, see updateTrayMenu()
+    m_act_tray_end = menu->addSeparator();
+    act = menu->addAction(tr("Quit"));
+    connect(act, SIGNAL(triggered()), SLOT(quit()));
+}
 
+QAction*
+MainWindow::createTrayAction(const QString &mountpoint)
+{
+    QAction *act = new QAction(m_mnu_tray);
+    act->setCheckable(true);
+    act->setProperty("mountpoint", mountpoint);
+    connect(act, SIGNAL(triggered()), SLOT(switchConnection()));
+    m_tray_actions[mountpoint] = act;
+    return act;
+}
+
+QMenu*
+MainWindow::trayGroup(const QString &remote)
+{
+    QPointer<QMenu> group = m_tray_groups.value(remote);
+    if (group) return group;
+
+    //Groups in order of first mount, before the end separator
+    group = new QMenu(remote, m_mnu_tray);
+    m_mnu_tray->insertMenu(m_act_tray_end, group);
+    m_tray_groups[remote] = group;
+    return group;
 }
 
 void
 MainWindow::updateTrayMenu(const QString &mountpoint)
 {
-    foreach (QAction *act, m_mnu_tray->actions())
-    {
-        if (act->property("mountpoint").toString() != mountpoint) continue;
-
-        act->setChecked(isConnected(mountpoint));
-        break;
-    }
+    QPointer<QAction> act = m_tray_actions.value(mountpoint);
+    if (act) act->setChecked(isConnected(mountpoint));
 }
 
 MountSettings*
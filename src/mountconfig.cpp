@@ -0,0 +1,106 @@
+#include "mountconfig.hpp"
+
+//Conversion of field values, one overload per field type
+
+static void
+writeField(QVariantMap &map, const QString &key, const QString &value)
+{
+    if (!value.isEmpty()) map[key] = value;
+}
+
+static void
+readField(const QVariantMap &map, const QString &key, QString *value)
+{
+    QVariantMap::const_iterator it = map.constFind(key);
+    if (it != map.constEnd()) *value = it.value().toString();
+}
+
+static bool
+isEmptyField(const QString &value)
+{
+    return value.isEmpty();
+}
+
+static void
+writeField(QVariantMap &map, const QString &key, bool value)
+{
+    if (value) map[key] = value; //default: false
+}
+
+static void
+readField(const QVariantMap &map, const QString &key, bool *value)
+{
+    QVariantMap::const_iterator it = map.constFind(key);
+    if (it != map.constEnd()) *value = it.value().toBool();
+}
+
+static bool
+isEmptyField(bool)
+{
+    return false; //false is a value
+}
+
+QString
+MountConfig::title() const
+{
+    return label.isEmpty() ? connection : label;
+}
+
+bool
+MountConfig::isValid() const
+{
+    return validate().isEmpty();
+}
+
+QStringList
+MountConfig::validate() const
+{
+    QStringList errors;
+    forEachField([this, &errors](const auto &field)
+    {
+        if (field.required && isEmptyField(this->*field.member))
+            errors << tr("Missing value: %1").arg(field.key);
+    });
+    return errors;
+}
+
+QVariantMap
+MountConfig::toVariantMap() const
+{
+    QVariantMap map = extra;
+    forEachField([this, &map](const auto &field)
+    {
+        writeField(map, field.key, this->*field.member);
+    });
+    return map;
+}
+
+MountConfig
+MountConfig::fromVariantMap(const QVariantMap &map)
+{
+    MountConfig config;
+    config.extra = map;
+    forEachField([&map, &config](const auto &field)
+    {
+        readField(map, field.key, &(config.*field.member));
+        config.extra.remove(field.key);
+    });
+    return config;
+}
+
+bool
+MountConfig::operator==(const MountConfig &other) const
+{
+    bool equal = extra == other.extra;
+    forEachField([this, &other, &equal](const auto &field)
+    {
+        equal = equal && this->*field.member == other.*field.member;
+    });
+    return equal;
+}
+
+bool
+MountConfig::operator!=(const MountConfig &other) const
+{
+    return !(*this == other);
+}
@@ -8,24 +8,33 @@ MountSettings::globalInstance()
 }
 
 MountSettings::MountSettings()
-             : SettingsManager()
+             : SettingsManager(),
+               m_mounts_cache_revision(~quint64(0))
 {
     if (!m_state["default_group_exception"].isValid())
         m_state["default_group_exception"] = QStringList() << "mount_list";
+    invalidateKeys();
+    m_key_mount_list = compileKey("mount_list");
 }
 
 MountSettings::MountSettings(const MountSettings &other)
-             : SettingsManager(other)
+             : SettingsManager(other),
+               m_mounts_cache(other.m_mounts_cache),
+               m_mounts_cache_revision(other.m_mounts_cache_revision),
+               m_mount_index(other.m_mount_index),
+               m_mount_id_index(other.m_mount_id_index)
 {
     if (!m_state["default_group_exception"].isValid())
         m_state["default_group_exception"] = QStringList() << "mount_list";
+    invalidateKeys();
+    m_key_mount_list = compileKey("mount_list");
 }
 
 QList<QVariantMap>
 MountSettings::mountConfigList() const
 {
     QList<QVariantMap> list;
-    foreach (QVariant v, variant("mount_list").toList())
+    foreach (QVariant v, variant(m_key_mount_list).toList())
     {
         QVariantMap cfg = v.toMap();
         list.append(cfg);
@@ -33,86 +42,302 @@ MountSettings::mountConfigList() const
     return list;
 }
 
+QList<MountConfig>
+MountSettings::mounts() const
+{
+    updateIndex();
+    return m_mounts_cache;
+}
+
+MountConfig
+MountSettings::mount(const QString &mountpoint) const
+{
+    int index = mountIndex(mountpoint);
+    if (index == -1)
+        return MountConfig(); //not found
+    return m_mounts_cache[index];
+}
+
+MountConfig
+MountSettings::mountById(const QString &id) const
+{
+    updateIndex();
+    int index = m_mount_id_index.value(id, -1);
+    if (id.isEmpty() || index == -1)
+        return MountConfig(); //not found
+    return m_mounts_cache[index];
+}
+
+int
+MountSettings::mountIndex(const QString &mountpoint) const
+{
+    updateIndex();
+    return m_mount_index.value(normalizeMountpoint(mountpoint), -1);
+}
+
 QVariantMap
 MountSettings::mountConfig(const QString &mountpoint) const
 {
-    foreach (QVariantMap cfg, mountConfigList())
-    {
-        QString cur_mountpoint = cfg.value("mountpoint").toString();
-        if (cur_mountpoint == mountpoint)
-            return cfg;
-    }
+    int index = mountIndex(mountpoint);
+    if (index == -1)
+        return QVariantMap(); //not found, return empty map
+    return m_mounts_cache[index].toVariantMap();
+}
+
+bool
+MountSettings::setMountConfig(const QString &mountpoint, const QVariantMap &config)
+{
+    if (config.isEmpty())
+        return updateMounts(QList<MountConfig>(), QStringList(mountpoint));
 
-    return QVariantMap(); //not found, return empty map
+    //Replace config item, a changed mountpoint is renamed in place (same id)
+    MountConfig cfg = MountConfig::fromVariantMap(config);
+    if (cfg.id.isEmpty())
+        cfg.id = mount(mountpoint).id;
+    return updateMounts(QList<MountConfig>() << cfg);
+}
+
+bool
+MountSettings::setMountConfig(const QVariantMap &config)
+{
+    QString mountpoint = config.value("mountpoint").toString();
+    if (mountpoint.isEmpty())
+        return false; //bad call, empty config
+    return setMountConfig(mountpoint, config);
 }
 
 void
-MountSettings::setMountConfig(const QString &mountpoint, const QVariantMap &config)
+MountSettings::removeMountConfig(const QString &mountpoint)
+{
+    setMountConfig(mountpoint, QVariantMap());
+}
+
+void
+MountSettings::setMountConfigList(const QList<QVariantMap> &config)
+{
+    QList<MountConfig> list;
+    list.reserve(config.size());
+    foreach (const QVariantMap &cfg, config)
+        list.append(MountConfig::fromVariantMap(cfg));
+    setMounts(list);
+}
+
+bool
+MountSettings::updateMounts(const QList<MountConfig> &configs, const QStringList &removed_mountpoints)
 {
-    //Find and replace config item
-    QList<QVariantMap> list = mountConfigList();
-    bool found = false;
-    for (int i = 0, ii = list.size(); i < ii; i++)
+    if (configs.isEmpty() && removed_mountpoints.isEmpty()) return true;
+    updateIndex();
+    bool ok = true;
+
+    //Stored list and typed list have the same order (see updateIndex()),
+    //only replaced or added entries are converted
+    QVariantList var_list = variant(m_key_mount_list).toList();
+    QList<MountConfig> list = m_mounts_cache;
+    foreach (const MountConfig &config, configs)
     {
-        QString cur_mountpoint = list[i].value("mountpoint").toString();
-        if (cur_mountpoint == mountpoint)
+        QStringList errors = config.validate();
+        if (!errors.isEmpty())
+        {
+            qWarning() << "Invalid mount config not saved:" << config.mountpoint << errors;
+            ok = false;
+            continue; //bad call
+        }
+        QString key = normalizeMountpoint(config.mountpoint);
+        MountConfig cfg = config;
+
+        //Known id: replaced in place, even if the mountpoint has changed (renamed),
+        //but not over another mount
+        int key_index = m_mount_index.value(key, -1);
+        int index = cfg.id.isEmpty() ? -1 : m_mount_id_index.value(cfg.id, -1);
+        if (index == -1)
+        {
+            index = key_index;
+        }
+        else if (key_index != -1 && key_index != index)
+        {
+            qWarning() << "Mountpoint already defined, not renamed:" << config.mountpoint;
+            ok = false;
+            continue;
+        }
+        if (index != -1)
+        {
+            if (cfg.id.isEmpty())
+                cfg.id = list[index].id;
+            QString old_key = normalizeMountpoint(list[index].mountpoint);
+            if (old_key != key)
+            {
+                m_mount_index.remove(old_key);
+                m_mount_index.insert(key, index);
+            }
+            m_mount_id_index.remove(list[index].id);
+            var_list[index] = cfg.toVariantMap();
+            list[index] = cfg;
+        }
+        else
         {
-            if (!config.isEmpty())
-                list[i] = config; //replace mount config
-            else
-                list.removeAt(i);
-            found = true;
-            break;
+            if (cfg.id.isEmpty())
+                cfg.id = createMountId();
+            index = list.size();
+            m_mount_index.insert(key, index);
+            var_list.append(cfg.toVariantMap());
+            list.append(cfg);
         }
+        m_mount_id_index.insert(cfg.id, index);
     }
-    if (!found && !config.isEmpty())
-        list.append(config); //add new mount config
 
-    QVariantList var_list;
-    foreach (QVariantMap item, list)
+    //Remove entries in one pass, positions change
+    QSet<int> removed_indexes;
+    foreach (const QString &mountpoint, removed_mountpoints)
+    {
+        int index = m_mount_index.value(normalizeMountpoint(mountpoint), -1);
+        if (index != -1) removed_indexes.insert(index);
+    }
+    if (configs.isEmpty() && removed_indexes.isEmpty()) return ok; //not found
+    if (!removed_indexes.isEmpty())
     {
-        var_list << QVariant(item);
+        QVariantList kept_var_list;
+        QList<MountConfig> kept_list;
+        kept_var_list.reserve(list.size());
+        kept_list.reserve(list.size());
+        for (int i = 0, ii = list.size(); i < ii; i++)
+        {
+            if (removed_indexes.contains(i)) continue;
+            kept_var_list.append(var_list[i]);
+            kept_list.append(list[i]);
+        }
+        var_list = kept_var_list;
+        list = kept_list;
     }
-    setVariant("mount_list", QVariant(var_list));
+
+    writeMounts(var_list, list);
+    return ok;
 }
 
 void
-MountSettings::setMountConfig(const QVariantMap &config)
+MountSettings::setMounts(const QList<MountConfig> &configs)
 {
-    QString mountpoint = config.value("mountpoint").toString();
-    if (mountpoint.isEmpty())
-        return; //bad call, empty config
-    setMountConfig(mountpoint, config);
+    updateIndex();
+
+    QVariantList var_list;
+    QList<MountConfig> list;
+    var_list.reserve(configs.size());
+    list.reserve(configs.size());
+    foreach (const MountConfig &config, configs)
+    {
+        QStringList errors = config.validate();
+        if (!errors.isEmpty())
+        {
+            qWarning() << "Invalid mount config not saved:" << config.mountpoint << errors;
+            continue;
+        }
+        MountConfig cfg = config;
+        if (cfg.id.isEmpty())
+        {
+            int index = m_mount_index.value(normalizeMountpoint(cfg.mountpoint), -1);
+            cfg.id = index != -1 ? m_mounts_cache[index].id : QString();
+            if (cfg.id.isEmpty())
+                cfg.id = createMountId();
+        }
+        var_list.append(cfg.toVariantMap());
+        list.append(cfg);
+    }
+
+    writeMounts(var_list, list);
+}
+
+QString
+MountSettings::normalizeMountpoint(const QString &mountpoint)
+{
+    if (mountpoint.isEmpty()) return mountpoint;
+    return QDir::cleanPath(mountpoint);
 }
 
 void
-MountSettings::removeMountConfig(const QString &mountpoint)
+MountSettings::updateIndex() const
 {
-    setMountConfig(mountpoint, QVariantMap());
+    //Convert only if data has changed since last call
+    if (m_mounts_cache_revision == revision()) return;
+
+    m_mounts_cache.clear();
+    foreach (QVariant v, variant(m_key_mount_list).toList())
+        m_mounts_cache.append(MountConfig::fromVariantMap(v.toMap()));
+    rebuildIndex();
+    m_mounts_cache_revision = revision();
 }
 
 void
-MountSettings::setMountConfigList(const QList<QVariantMap> &config)
+MountSettings::rebuildIndex() const
 {
-    //List of old mountpoints
-    QStringList old_mountpoints;
-    foreach (QVariantMap cfg, mountConfigList())
+    m_mount_index.clear();
+    m_mount_id_index.clear();
+    m_mount_index.reserve(m_mounts_cache.size());
+    for (int i = 0, ii = m_mounts_cache.size(); i < ii; i++)
     {
-        old_mountpoints << cfg["mountpoint"].toString();
+        const MountConfig &cfg = m_mounts_cache[i];
+        m_mount_index.insert(normalizeMountpoint(cfg.mountpoint), i);
+        if (!cfg.id.isEmpty())
+            m_mount_id_index.insert(cfg.id, i);
     }
+}
+
+void
+MountSettings::writeMounts(const QVariantList &var_list, const QList<MountConfig> &list)
+{
+    setVariant(m_key_mount_list, QVariant(var_list));
+
+    //Typed list is already up to date, keep it for the new revision
+    m_mounts_cache = list;
+    rebuildIndex();
+    m_mounts_cache_revision = revision();
+}
+
+QString
+MountSettings::createMountId()
+{
+    return QUuid::createUuid().toString(QUuid::WithoutBraces);
+}
+
+QStringList
+MountSettings::profileNames() const
+{
+    QStringList names;
+    foreach (QVariant v, variant("benchmark_profiles").toList())
+        names << v.toMap().value("name").toString();
+    return names;
+}
 
-    //Add, update mountpoints
-    foreach (QVariantMap cfg, config)
+QStringList
+MountSettings::profileArguments(const QString &name) const
+{
+    if (name.isEmpty()) return QStringList();
+    foreach (QVariant v, variant("benchmark_profiles").toList())
     {
-        old_mountpoints.removeAll(cfg["mountpoint"].toString());
-        setMountConfig(cfg);
+        QVariantMap profile = v.toMap();
+        if (profile.value("name").toString() == name)
+            return profile.value("args").toString().split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
     }
+    return QStringList();
+}
 
-    //Delete removed mountpoints
-    foreach (QString mp, old_mountpoints)
+void
+MountSettings::diffMountConfigList(const QList<MountConfig> &old_list, const QList<MountConfig> &new_list,
+    QStringList *added, QStringList *removed, QStringList *changed)
+{
+    //Pointers into old_list (const, never detached), normalized like the index
+    QHash<QString, const MountConfig*> old_map;
+    for (int i = 0, ii = old_list.size(); i < ii; i++)
+        old_map[normalizeMountpoint(old_list[i].mountpoint)] = &old_list[i];
+
+    foreach (const MountConfig &cfg, new_list)
     {
-        removeMountConfig(mp);
+        const MountConfig *old_cfg = old_map.take(normalizeMountpoint(cfg.mountpoint));
+        if (!old_cfg)
+            added->append(cfg.mountpoint);
+        else if (*old_cfg != cfg)
+            changed->append(cfg.mountpoint);
     }
 
+    //Remaining old entries are gone
+    foreach (const MountConfig *old_cfg, old_map.values())
+        removed->append(old_cfg->mountpoint);
 }
-
@@ -0,0 +1,221 @@
+#include "mountstats.hpp"
+
+void
+MountStatsHistory::append(float rate)
+{
+    if (rates.size() != capacity) rates.resize(capacity);
+    rates[head] = rate;
+    head = (head + 1) % capacity;
+    if (count < capacity) count++;
+    revision++;
+}
+
+float
+MountStatsHistory::at(int i) const
+{
+    return rates[(head - count + i + capacity) % capacity];
+}
+
+float
+MountStatsHistory::max() const
+{
+    float value = 0;
+    for (int i = 0; i < count; i++)
+        value = qMax(value, at(i));
+    return value;
+}
+
+float
+MountStatsHistory::last() const
+{
+    if (!count) return 0;
+    return at(count - 1);
+}
+
+MountStats*
+MountStats::globalInstance()
+{
+    static MountStats *stats = new MountStats(qApp);
+    return stats;
+}
+
+MountStats::MountStats(QObject *parent)
+          : QObject(parent)
+{
+    m_clock.start();
+    m_tmr_poll.setInterval(2000);
+    connect(&m_tmr_poll, SIGNAL(timeout()), SLOT(poll()));
+}
+
+void
+MountStats::setInterval(int interval_ms)
+{
+    m_tmr_poll.setInterval(interval_ms);
+}
+
+MountStatsHistory
+MountStats::history(const QString &mountpoint) const
+{
+    return m_history.value(mountpoint);
+}
+
+QPixmap
+MountStats::sparkline(const QString &mountpoint, const QSize &size, const QColor &color)
+{
+    QHash<QString, MountStatsHistory>::const_iterator it = m_history.constFind(mountpoint);
+    if (it == m_history.constEnd() || !it.value().count) return QPixmap();
+    const MountStatsHistory &history = it.value();
+
+    //Unchanged since last time
+    CachedPixmap &cached = m_pixmaps[mountpoint];
+    if (!cached.pixmap.isNull() && cached.revision == history.revision &&
+        cached.size == size && cached.color == color)
+        return cached.pixmap;
+
+    qreal dpr = qApp->devicePixelRatio();
+    QPixmap pixmap(size * dpr);
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    //Pending uploads at the right, "3^"
+    QRectF graph(0, 0, size.width(), size.height());
+    if (history.uploads > 0)
+    {
+        QFont fnt = painter.font();
+        fnt.setPixelSize(qMax(8, size.height() / 2));
+        painter.setFont(fnt);
+        QString text = QString::number(history.uploads) + QChar(0x2191); //upwards arrow
+        int width = QFontMetrics(fnt).boundingRect(text).width() + 2;
+        painter.setPen(color);
+        painter.drawText(QRectF(size.width() - width, 0, width, size.height()), Qt::AlignRight | Qt::AlignVCenter, text);
+        graph.setRight(size.width() - width - 2);
+    }
+
+    //Newest sample at the right, scaled to the largest one
+    float max = qMax(history.max(), 1.0f);
+    qreal step = graph.width() / (MountStatsHistory::capacity - 1);
+    QPainterPath path;
+    for (int i = 0; i < history.count; i++)
+    {
+        qreal x = graph.right() - (history.count - 1 - i) * step;
+        qreal y = graph.bottom() - 1 - history.at(i) / max * (graph.height() - 2);
+        if (i == 0)
+            path.moveTo(x, y);
+        else
+            path.lineTo(x, y);
+    }
+    QPainterPath area = path;
+    area.lineTo(graph.right(), graph.bottom());
+    area.lineTo(graph.right() - (history.count - 1) * step, graph.bottom());
+    area.closeSubpath();
+    QColor fill = color;
+    fill.setAlpha(60);
+    painter.fillPath(area, fill);
+    painter.setPen(QPen(color, 1.5));
+    painter.drawPath(path);
+    painter.end();
+
+    cached.pixmap = pixmap;
+    cached.revision = history.revision;
+    cached.size = size;
+    cached.color = color;
+    return pixmap;
+}
+
+void
+MountStats::setActive(bool active)
+{
+    if (active == m_tmr_poll.isActive()) return;
+    if (active)
+    {
+        m_tmr_poll.start();
+        poll();
+    }
+    else
+    {
+        m_tmr_poll.stop();
+    }
+}
+
+void
+MountStats::clear(const QString &mountpoint)
+{
+    m_pixmaps.remove(mountpoint);
+    if (m_history.remove(mountpoint))
+        emit statsChanged(mountpoint);
+}
+
+void
+MountStats::poll()
+{
+    //Mounts that have stopped
+    QSet<QString> active;
+    foreach (QPointer<MountControl> mount, MountControl::activeControls())
+        active << mount->mountpoint();
+    foreach (QString mountpoint, m_history.keys())
+        if (!active.contains(mountpoint)) clear(mountpoint);
+
+    //One request pair per mount at a time (slow rc: skip this round)
+    foreach (QPointer<MountControl> mount, MountControl::activeControls())
+    {
+        QString mountpoint = mount->mountpoint();
+        if (m_pending.contains(mountpoint)) continue;
+        QNetworkReply *reply = mount->rcCall("core/stats");
+        if (!reply) continue;
+        reply->setProperty("mountpoint", mountpoint);
+        connect(reply, SIGNAL(finished()), SLOT(coreStatsReceived()));
+        m_pending << mountpoint;
+        if ((reply = mount->rcCall("vfs/stats")))
+        {
+            reply->setProperty("mountpoint", mountpoint);
+            connect(reply, SIGNAL(finished()), SLOT(vfsStatsReceived()));
+        }
+    }
+}
+
+void
+MountStats::coreStatsReceived()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (!reply) return;
+    reply->deleteLater();
+    QString mountpoint = reply->property("mountpoint").toString();
+    m_pending.remove(mountpoint);
+    if (reply->error() != QNetworkReply::NoError) return;
+
+    //Rate from transferred bytes since the last sample
+    QJsonObject stats = QJsonDocument::fromJson(reply->readAll()).object();
+    qint64 bytes = (qint64)stats.value("bytes").toDouble();
+    qint64 now = m_clock.elapsed();
+    MountStatsHistory &history = m_history[mountpoint];
+    if (history.last_bytes >= 0 && now > history.last_ms)
+    {
+        qint64 delta = qMax(Q_INT64_C(0), bytes - history.last_bytes); //counters reset
+        history.append(delta * 1000.0f / (now - history.last_ms));
+        emit statsChanged(mountpoint);
+    }
+    history.last_bytes = bytes;
+    history.last_ms = now;
+}
+
+void
+MountStats::vfsStatsReceived()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (!reply) return;
+    reply->deleteLater();
+    QString mountpoint = reply->property("mountpoint").toString();
+    if (reply->error() != QNetworkReply::NoError) return;
+
+    //Upload queue, see ShutdownCoordinator
+    QJsonObject stats = QJsonDocument::fromJson(reply->readAll()).object();
+    QJsonObject cache = stats.value("diskCache").toObject();
+    int uploads = cache.value("uploadsInProgress").toInt() + cache.value("uploadsQueued").toInt();
+    QHash<QString, MountStatsHistory>::iterator it = m_history.find(mountpoint);
+    if (it == m_history.end() || it.value().uploads == uploads) return;
+    it.value().uploads = uploads;
+    it.value().revision++;
+    emit statsChanged(mountpoint);
+}
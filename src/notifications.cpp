@@ -0,0 +1,156 @@
+#include "notifications.hpp"
+
+NotificationAggregator::NotificationAggregator(QSystemTrayIcon *tray_icon, QObject *parent)
+                      : QObject(parent),
+                        m_tray_icon(tray_icon),
+                        m_max_entries(500)
+{
+    m_tmr_flush.setSingleShot(true);
+    m_tmr_flush.setInterval(1500);
+    connect(&m_tmr_flush, SIGNAL(timeout()), SLOT(flush()));
+}
+
+void
+NotificationAggregator::setDelay(int delay_ms)
+{
+    m_tmr_flush.setInterval(delay_ms);
+}
+
+void
+NotificationAggregator::setMaxEntries(int count)
+{
+    m_max_entries = count;
+}
+
+QList<EventLogEntry>
+NotificationAggregator::entries() const
+{
+    return m_entries;
+}
+
+EventLogEntry
+NotificationAggregator::entry(int index) const
+{
+    return m_entries.value(index);
+}
+
+void
+NotificationAggregator::notify(QSystemTrayIcon::MessageIcon level, const QString &category, const QString &title, const QString &message)
+{
+    EventLogEntry entry;
+    entry.time = QDateTime::currentDateTime();
+    entry.level = level;
+    entry.category = category;
+    entry.title = title;
+    entry.message = message;
+
+    //Log, oldest entries dropped
+    m_entries.append(entry);
+    emit entryAdded(m_entries.size() - 1);
+    int excess = m_entries.size() - m_max_entries;
+    if (excess > 0)
+    {
+        m_entries.erase(m_entries.begin(), m_entries.begin() + excess);
+        emit entriesRemoved(excess);
+    }
+
+    //Shown after the delay, together with the events that follow
+    //(the timer is not restarted, so a steady stream is still shown)
+    m_pending.append(entry);
+    if (!m_tmr_flush.isActive())
+        m_tmr_flush.start();
+}
+
+void
+NotificationAggregator::flush()
+{
+    m_tmr_flush.stop();
+    if (m_pending.isEmpty()) return;
+    QList<EventLogEntry> pending = m_pending;
+    m_pending.clear();
+    if (!m_tray_icon) return;
+
+    if (pending.size() == 1)
+    {
+        const EventLogEntry &entry = pending.first();
+        m_tray_icon->showMessage(entry.title, entry.message, entry.level);
+        return;
+    }
+
+    //Summary: count per category (in order), most severe icon
+    QStringList categories;
+    QHash<QString, int> counts;
+    QSystemTrayIcon::MessageIcon level = QSystemTrayIcon::NoIcon;
+    foreach (const EventLogEntry &entry, pending)
+    {
+        if (!counts.contains(entry.category)) categories << entry.category;
+        counts[entry.category]++;
+        if (entry.level > level) level = entry.level; //Information < Warning < Critical
+    }
+    QStringList parts;
+    foreach (QString category, categories)
+        parts << QString("%1 %2").arg(counts[category]).arg(category);
+    QString title = tr("%1 events").arg(pending.size());
+    QString msg = tr("%1. Click for details.").arg(parts.join(", "));
+    m_tray_icon->showMessage(title, msg, level);
+}
+
+EventLogWindow::EventLogWindow(NotificationAggregator *notifications, QWidget *parent)
+              : QDialog(parent),
+                m_notifications(notifications)
+{
+    setWindowTitle(tr("Event log"));
+    resize(600, 400);
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    setLayout(vbox);
+    m_tree = new QTreeWidget;
+    m_tree->setRootIsDecorated(false);
+    m_tree->setUniformRowHeights(true);
+    m_tree->setHeaderLabels(QStringList() << tr("Time") << tr("Event") << tr("Details"));
+    m_tree->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    vbox->addWidget(m_tree);
+
+    QHBoxLayout *hbox = new QHBoxLayout;
+    hbox->addStretch();
+    QPushButton *btn_close = new QPushButton(tr("&Close"));
+    connect(btn_close, SIGNAL(clicked()), SLOT(close()));
+    hbox->addWidget(btn_close);
+    vbox->addLayout(hbox);
+
+    //Existing entries, then new ones as they come in
+    foreach (const EventLogEntry &entry, notifications->entries())
+        addItem(entry);
+    m_tree->scrollToBottom();
+    connect(notifications, SIGNAL(entryAdded(int)), SLOT(entryAdded(int)));
+    connect(notifications, SIGNAL(entriesRemoved(int)), SLOT(entriesRemoved(int)));
+}
+
+void
+EventLogWindow::entryAdded(int index)
+{
+    if (!m_notifications) return;
+    addItem(m_notifications->entry(index));
+    m_tree->scrollToBottom();
+}
+
+void
+EventLogWindow::entriesRemoved(int count)
+{
+    for (int i = 0; i < count && m_tree->topLevelItemCount(); i++)
+        delete m_tree->takeTopLevelItem(0);
+}
+
+void
+EventLogWindow::addItem(const EventLogEntry &entry)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem(m_tree);
+    item->setText(0, entry.time.toString("yyyy-MM-dd HH:mm:ss"));
+    item->setText(1, entry.title);
+    item->setText(2, entry.message.split('\n').first());
+    item->setToolTip(2, entry.message);
+    if (entry.level == QSystemTrayIcon::Critical)
+        item->setForeground(1, QColor("crimson"));
+    else if (entry.level == QSystemTrayIcon::Warning)
+        item->setForeground(1, QColor("darkorange"));
+}
@@ -0,0 +1,163 @@
+#include "rclonejobs.hpp"
+
+RcloneJobQueue::RcloneJobQueue(QObject *parent)
+              : QObject(parent),
+                m_max_running(4),
+                m_timeout(30000)
+{
+}
+
+RcloneJobQueue::~RcloneJobQueue()
+{
+    //Don't leave rclone processes behind
+    foreach (QProcess *proc, m_running.keys())
+    {
+        disconnect(proc, 0, this, 0);
+        proc->kill();
+        proc->waitForFinished(1000);
+    }
+}
+
+void
+RcloneJobQueue::setMaxRunning(int count)
+{
+    m_max_running = qMax(1, count);
+    startNext();
+}
+
+int
+RcloneJobQueue::maxRunning() const
+{
+    return m_max_running;
+}
+
+void
+RcloneJobQueue::setTimeout(int timeout_ms)
+{
+    m_timeout = timeout_ms;
+}
+
+bool
+RcloneJobQueue::enqueue(const QString &key, const QStringList &args, int max_lines)
+{
+    if (isPending(key)) return false;
+    Job job;
+    job.key = key;
+    job.args = args;
+    job.max_lines = max_lines;
+    m_queue.append(job);
+    startNext();
+    return true;
+}
+
+bool
+RcloneJobQueue::isPending(const QString &key) const
+{
+    if (m_running.values().contains(key)) return true;
+    for (int i = 0, ii = m_queue.size(); i < ii; i++)
+    {
+        if (m_queue[i].key == key) return true;
+    }
+    return false;
+}
+
+void
+RcloneJobQueue::processOutput()
+{
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc || !m_running.contains(proc)) return;
+    if (proc->property("stopped").toBool()) return;
+
+    //Enough lines, peeked (output is read when finished)
+    int max_lines = proc->property("max_lines").toInt();
+    if (proc->peek(proc->bytesAvailable()).count('\n') < max_lines) return;
+    proc->setProperty("stopped", true);
+    proc->setProperty("elapsed_ms", m_started.value(proc).elapsed());
+    proc->kill(); //finished() follows
+}
+
+void
+RcloneJobQueue::processFinished()
+{
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc || !m_running.contains(proc)) return;
+
+    QVariantMap result;
+    bool timed_out = proc->property("timed_out").toBool();
+    bool stopped = proc->property("stopped").toBool() && !timed_out;
+    bool normal = proc->exitStatus() == QProcess::NormalExit;
+    result["ok"] = stopped || (normal && proc->exitCode() == 0 && !timed_out);
+    result["rc"] = stopped ? 0 : normal ? proc->exitCode() : -1;
+    result["output"] = proc->readAllStandardOutput();
+    result["error"] = QString::fromUtf8(proc->readAllStandardError()).trimmed();
+    result["timed_out"] = timed_out;
+    finish(proc, result);
+}
+
+void
+RcloneJobQueue::processError(QProcess::ProcessError error)
+{
+    //Other errors are followed by finished()
+    if (error != QProcess::FailedToStart) return;
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc || !m_running.contains(proc)) return;
+
+    QVariantMap result;
+    result["ok"] = false;
+    result["rc"] = -1;
+    result["error"] = proc->errorString();
+    result["timed_out"] = false;
+    finish(proc, result);
+}
+
+void
+RcloneJobQueue::processTimeout()
+{
+    QTimer *timer = qobject_cast<QTimer*>(QObject::sender());
+    QProcess *proc = timer ? qobject_cast<QProcess*>(timer->parent()) : 0;
+    if (!proc || !m_running.contains(proc)) return;
+
+    //finished() follows
+    proc->setProperty("timed_out", true);
+    proc->kill();
+}
+
+void
+RcloneJobQueue::startNext()
+{
+    while (m_running.size() < m_max_running && !m_queue.isEmpty())
+    {
+        Job job = m_queue.takeFirst();
+        QProcess *proc = new QProcess(this);
+        m_running.insert(proc, job.key);
+        if (job.max_lines > 0)
+        {
+            proc->setProperty("max_lines", job.max_lines);
+            connect(proc, SIGNAL(readyReadStandardOutput()), SLOT(processOutput()));
+        }
+        connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(processFinished()));
+        connect(proc, SIGNAL(error(QProcess::ProcessError)), SLOT(processError(QProcess::ProcessError)));
+        QTimer *timer = new QTimer(proc);
+        timer->setSingleShot(true);
+        connect(timer, SIGNAL(timeout()), SLOT(processTimeout()));
+        timer->start(m_timeout);
+        m_started[proc].start();
+        proc->start(MountControl::getRclonePath(), job.args);
+    }
+}
+
+void
+RcloneJobQueue::finish(QProcess *proc, const QVariantMap &result)
+{
+    QString key = m_running.take(proc);
+    QVariantMap job_result = result;
+    job_result["elapsed_ms"] = m_started.take(proc).elapsed();
+    if (proc->property("stopped").toBool())
+        job_result["elapsed_ms"] = proc->property("elapsed_ms");
+    disconnect(proc, 0, this, 0);
+    proc->deleteLater();
+
+    //Next job first, a receiver may enqueue again
+    startNext();
+    emit finished(key, job_result);
+}
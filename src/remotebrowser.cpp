@@ -0,0 +1,251 @@
+#include "remotebrowser.hpp"
+
+RemoteBrowser::RemoteBrowser(const QString &remote, const QString &path, QWidget *parent)
+             : QDialog(parent),
+               m_remote(remote),
+               m_path(path),
+               m_changed(false),
+               m_preselecting(false)
+{
+    setWindowTitle(tr("Select remote path"));
+    QVBoxLayout *vbox = new QVBoxLayout;
+    setLayout(vbox);
+
+    m_tree = new QTreeWidget;
+    m_tree->setHeaderHidden(true);
+    m_tree->setUniformRowHeights(true);
+    connect(m_tree, SIGNAL(itemExpanded(QTreeWidgetItem*)), SLOT(itemExpanded(QTreeWidgetItem*)));
+    connect(m_tree, SIGNAL(itemSelectionChanged()), SLOT(selectionChanged()));
+    vbox->addWidget(m_tree);
+
+    m_lbl_status = new QLabel;
+    m_lbl_status->setWordWrap(true);
+    vbox->addWidget(m_lbl_status);
+
+    QHBoxLayout *hbox = new QHBoxLayout;
+    hbox->addStretch();
+    m_btn_ok = new QPushButton(tr("&Select"));
+    connect(m_btn_ok, SIGNAL(clicked()), SLOT(accept()));
+    hbox->addWidget(m_btn_ok);
+    QPushButton *btn_cancel = new QPushButton(tr("&Cancel"));
+    connect(btn_cancel, SIGNAL(clicked()), SLOT(reject()));
+    hbox->addWidget(btn_cancel);
+    vbox->addLayout(hbox);
+
+    //Root of remote, listed right away
+    //The tree is expanded towards the current path while items arrive (addItem())
+    while (m_path.startsWith('/')) m_path.remove(0, 1);
+    while (m_path.endsWith('/')) m_path.chop(1);
+    QTreeWidgetItem *root = addItem(0, "");
+    root->setText(0, m_remote + ":");
+    m_tree->addTopLevelItem(root);
+    m_preselecting = true;
+    m_tree->setCurrentItem(root);
+    m_preselecting = false;
+    root->setExpanded(true);
+
+    m_lbl_status->setText(tr("Current: %1:%2").arg(m_remote, m_path.isEmpty() ? "/" : m_path));
+    resize(500, 400);
+}
+
+RemoteBrowser::~RemoteBrowser()
+{
+    //Stop listings that are still running
+    foreach (QProcess *proc, m_listings.keys())
+    {
+        disconnect(proc, 0, this, 0);
+        proc->kill();
+        proc->waitForFinished(1000);
+    }
+}
+
+QString
+RemoteBrowser::selectedPath() const
+{
+    //Current path until the user selects something else
+    QTreeWidgetItem *item = m_tree->currentItem();
+    if (!m_changed || !item) return m_path;
+    return itemPath(item);
+}
+
+void
+RemoteBrowser::setCacheTimeout(int seconds)
+{
+    cacheTimeout() = seconds;
+}
+
+void
+RemoteBrowser::itemExpanded(QTreeWidgetItem *item)
+{
+    //Children are listed on first expand only
+    if (item->data(0, Qt::UserRole + 1).toBool()) return;
+    item->setData(0, Qt::UserRole + 1, true);
+    list(item);
+}
+
+void
+RemoteBrowser::selectionChanged()
+{
+    if (!m_preselecting) m_changed = true;
+    showSelection();
+}
+
+void
+RemoteBrowser::showSelection()
+{
+    QTreeWidgetItem *item = m_tree->currentItem();
+    if (!item) return;
+    QString path = itemPath(item);
+    m_lbl_status->setText(tr("Selected: %1:%2").arg(m_remote, path.isEmpty() ? "/" : path));
+}
+
+void
+RemoteBrowser::listingOutput()
+{
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc) return;
+    while (proc->canReadLine())
+        parseLine(proc, proc->readLine());
+}
+
+void
+RemoteBrowser::listingFinished(int rc, QProcess::ExitStatus status)
+{
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc) return;
+    foreach (const QByteArray &line, proc->readAll().split('\n'))
+        parseLine(proc, line);
+
+    QTreeWidgetItem *item = m_listings.take(proc);
+    QStringList dirs = m_listed.take(proc);
+    proc->deleteLater();
+    if (!item) return;
+
+    QString path = itemPath(item);
+    if (status != QProcess::NormalExit || rc != 0)
+    {
+        //Try again on next expand
+        item->setData(0, Qt::UserRole + 1, false);
+        item->setExpanded(false);
+        QString error = QString::fromUtf8(proc->readAllStandardError()).trimmed();
+        m_lbl_status->setText(tr("Cannot list %1:%2\n%3").arg(m_remote, path, error));
+        return;
+    }
+
+    Listing listing;
+    listing.dirs = dirs;
+    listing.time = QDateTime::currentDateTimeUtc();
+    cache().insert(m_remote + ":" + path, listing);
+    if (!item->childCount())
+        item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicator);
+    if (m_listings.isEmpty())
+        showSelection();
+}
+
+void
+RemoteBrowser::listingError(QProcess::ProcessError error)
+{
+    //Other errors are followed by finished()
+    if (error != QProcess::FailedToStart) return;
+    QProcess *proc = qobject_cast<QProcess*>(QObject::sender());
+    if (!proc) return;
+    QTreeWidgetItem *item = m_listings.take(proc);
+    m_listed.remove(proc);
+    proc->deleteLater();
+    if (!item) return;
+
+    //Try again on next expand
+    item->setData(0, Qt::UserRole + 1, false);
+    item->setExpanded(false);
+    m_lbl_status->setText(tr("Cannot start rclone: %1").arg(proc->errorString()));
+}
+
+QHash<QString, RemoteBrowser::Listing>&
+RemoteBrowser::cache()
+{
+    //remote:path => directory names
+    static QHash<QString, Listing> listings;
+    return listings;
+}
+
+int&
+RemoteBrowser::cacheTimeout()
+{
+    static int seconds = 300;
+    return seconds;
+}
+
+QTreeWidgetItem*
+RemoteBrowser::addItem(QTreeWidgetItem *parent, const QString &name)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem;
+    item->setText(0, name);
+    QString parent_path = parent ? itemPath(parent) : "";
+    QString path = parent_path.isEmpty() ? name : parent_path + "/" + name;
+    item->setData(0, Qt::UserRole, path);
+    item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator); //unknown yet
+    if (parent)
+        parent->addChild(item);
+
+    //On the way to the current path, unless the user has selected something else
+    if (parent && !m_changed && (m_path == path || m_path.startsWith(path + "/")))
+    {
+        m_preselecting = true;
+        m_tree->setCurrentItem(item);
+        m_preselecting = false;
+        if (m_path != path) item->setExpanded(true);
+    }
+    return item;
+}
+
+void
+RemoteBrowser::list(QTreeWidgetItem *item)
+{
+    QString path = itemPath(item);
+    QString key = m_remote + ":" + path;
+
+    //Cached listing, if recent enough
+    QHash<QString, Listing>::const_iterator it = cache().constFind(key);
+    if (it != cache().constEnd() && it.value().time.secsTo(QDateTime::currentDateTimeUtc()) < cacheTimeout())
+    {
+        foreach (const QString &name, it.value().dirs)
+            addItem(item, name);
+        if (!item->childCount())
+            item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicator);
+        return;
+    }
+
+    //One level only, items are added while output arrives
+    QProcess *proc = new QProcess(this);
+    m_listings.insert(proc, item);
+    m_listed.insert(proc, QStringList());
+    connect(proc, SIGNAL(readyReadStandardOutput()), SLOT(listingOutput()));
+    connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(listingFinished(int, QProcess::ExitStatus)));
+    connect(proc, SIGNAL(errorOccurred(QProcess::ProcessError)), SLOT(listingError(QProcess::ProcessError)));
+    m_lbl_status->setText(tr("Listing %1...").arg(key));
+    proc->start(MountControl::getRclonePath(), QStringList() << "lsjson" << "--dirs-only" << "--no-modtime" << "--no-mimetype" << key);
+}
+
+void
+RemoteBrowser::parseLine(QProcess *proc, const QByteArray &line)
+{
+    //lsjson prints one object per line: [ {...}, {...} ]
+    QByteArray object = line.trimmed();
+    if (object.endsWith(',')) object.chop(1);
+    if (!object.startsWith('{')) return;
+
+    QTreeWidgetItem *item = m_listings.value(proc);
+    if (!item) return;
+    QJsonObject j_obj = QJsonDocument::fromJson(object).object();
+    if (!j_obj.value("IsDir").toBool()) return;
+    QString name = j_obj.value("Name").toString();
+    if (name.isEmpty()) return;
+    addItem(item, name);
+    m_listed[proc] << name;
+}
+
+QString
+RemoteBrowser::itemPath(QTreeWidgetItem *item) const
+{
+    return item->data(0, Qt::UserRole).toString();
+}
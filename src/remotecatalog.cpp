@@ -0,0 +1,286 @@
+#include "remotecatalog.hpp"
+
+RemoteCatalog*
+RemoteCatalog::globalInstance()
+{
+    static RemoteCatalog *catalog = new RemoteCatalog(qApp);
+    return catalog;
+}
+
+RemoteCatalog::RemoteCatalog(QObject *parent)
+             : QObject(parent),
+               m_loaded(false),
+               m_mtime(-1),
+               m_size(-1)
+{
+    //Wait for writes to settle, then reload
+    m_tmr_reload.setSingleShot(true);
+    m_tmr_reload.setInterval(200);
+    connect(&m_tmr_reload, SIGNAL(timeout()), SLOT(refresh()));
+    connect(&m_load_watcher, SIGNAL(finished()), SLOT(loaded()));
+
+    //The directory is watched too because rclone replaces the file
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, SIGNAL(fileChanged(const QString&)), SLOT(fileChanged()));
+    connect(m_watcher, SIGNAL(directoryChanged(const QString&)), SLOT(fileChanged()));
+    watch();
+}
+
+QString
+RemoteCatalog::configPath()
+{
+    //Same lookup as rclone (default location only)
+    QString path = qEnvironmentVariable("RCLONE_CONFIG");
+    if (path.isEmpty())
+        path = QDir::home().absoluteFilePath(".config/rclone/rclone.conf");
+    return path;
+}
+
+QStringList
+RemoteCatalog::remoteNames()
+{
+    QStringList names;
+    foreach (const RemoteInfo &info, remotes())
+        names << info.name;
+    return names;
+}
+
+QList<RemoteInfo>
+RemoteCatalog::remotes()
+{
+    //First access: load in background, changed() follows (never blocks)
+    if (!m_loaded && !m_load_watcher.isRunning())
+        refresh();
+    return m_remotes;
+}
+
+RemoteInfo
+RemoteCatalog::remote(const QString &name)
+{
+    remotes(); //start loading
+    int index = m_index.value(name, -1);
+    if (index == -1) return RemoteInfo();
+    return m_remotes[index];
+}
+
+bool
+RemoteCatalog::isLoaded() const
+{
+    return m_loaded;
+}
+
+QString
+RemoteCatalog::errorString() const
+{
+    return m_error;
+}
+
+QVariantMap
+RemoteCatalog::readConfig(const QString &path, const QString &rclone_path)
+{
+    QVariantMap result;
+    QFileInfo file_info(path);
+    result["mtime"] = file_info.exists() ? file_info.lastModified().toMSecsSinceEpoch() : -1;
+    result["size"] = file_info.exists() ? file_info.size() : -1;
+    if (!file_info.exists())
+    {
+        //No config, no remotes
+        result["ok"] = true;
+        return result;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        result["error"] = file.errorString();
+        return result;
+    }
+
+    QList<QVariantMap> remotes;
+    if (file.peek(4096).contains("RCLONE_ENCRYPT_V"))
+    {
+        //Encrypted, ask rclone
+        file.close();
+        QString error;
+        if (!readDump(path, rclone_path, &remotes, &error))
+        {
+            result["error"] = error;
+            return result;
+        }
+    }
+    else if (!parseIni(&file, &remotes))
+    {
+        result["error"] = QObject::tr("Cannot parse %1").arg(path);
+        return result;
+    }
+
+    QVariantList list;
+    foreach (const QVariantMap &remote, remotes)
+        list << remote;
+    result["ok"] = true;
+    result["remotes"] = list;
+    return result;
+}
+
+void
+RemoteCatalog::refresh()
+{
+    if (m_load_watcher.isRunning())
+    {
+        m_tmr_reload.start(); //try again later
+        return;
+    }
+
+    //Same file as last time, nothing to do
+    QFileInfo file_info(configPath());
+    qint64 mtime = file_info.exists() ? file_info.lastModified().toMSecsSinceEpoch() : -1;
+    qint64 size = file_info.exists() ? file_info.size() : -1;
+    if (m_loaded && mtime == m_mtime && size == m_size) return;
+
+    //Read and parse in background
+    m_load_watcher.setFuture(QtConcurrent::run(readConfig, configPath(), MountControl::getRclonePath()));
+}
+
+void
+RemoteCatalog::fileChanged()
+{
+    watch();
+    m_tmr_reload.start();
+}
+
+void
+RemoteCatalog::loaded()
+{
+    setResult(m_load_watcher.result());
+}
+
+bool
+RemoteCatalog::parseIni(QIODevice *device, QList<QVariantMap> *remotes)
+{
+    //[name]
+    //type = drive
+    //key = value
+    QTextStream stream(device);
+    QVariantMap remote;
+    QVariantMap options;
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#') || line.startsWith(';'))
+            continue;
+
+        if (line.startsWith('[') && line.endsWith(']'))
+        {
+            if (!remote.isEmpty())
+            {
+                remote["options"] = options;
+                remotes->append(remote);
+            }
+            remote.clear();
+            options.clear();
+            remote["name"] = line.mid(1, line.size() - 2).trimmed();
+            continue;
+        }
+
+        int pos = line.indexOf('=');
+        if (pos == -1 || remote.isEmpty())
+            return false; //not a config file
+        QString key = line.left(pos).trimmed();
+        QString value = line.mid(pos + 1).trimmed();
+        if (key == "type")
+            remote["type"] = value;
+        else
+            options[key] = value;
+    }
+    if (!remote.isEmpty())
+    {
+        remote["options"] = options;
+        remotes->append(remote);
+    }
+
+    return true;
+}
+
+bool
+RemoteCatalog::readDump(const QString &path, const QString &rclone_path, QList<QVariantMap> *remotes, QString *error)
+{
+    //rclone config dump: {"name": {"type": "drive", ...}, ...}
+    QProcess proc;
+    proc.start(rclone_path, QStringList() << "config" << "dump" << "--config" << path << "--ask-password=false");
+    proc.closeWriteChannel();
+    if (!proc.waitForFinished(10000) || proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0)
+    {
+        proc.kill();
+        *error = QString::fromUtf8(proc.readAllStandardError()).trimmed();
+        if (error->isEmpty())
+            *error = QObject::tr("Cannot read encrypted config %1").arg(path);
+        return false;
+    }
+
+    QJsonObject j_obj = QJsonDocument::fromJson(proc.readAllStandardOutput()).object();
+    foreach (QString name, j_obj.keys())
+    {
+        QVariantMap options = j_obj.value(name).toObject().toVariantMap();
+        QVariantMap remote;
+        remote["name"] = name;
+        remote["type"] = options.take("type");
+        remote["options"] = options;
+        remotes->append(remote);
+    }
+    return true;
+}
+
+void
+RemoteCatalog::setResult(const QVariantMap &result)
+{
+    bool first = !m_loaded;
+    m_loaded = true;
+    m_mtime = result.value("mtime").toLongLong();
+    m_size = result.value("size").toLongLong();
+    m_error = result.value("error").toString();
+    if (!result.value("ok").toBool())
+    {
+        //Keep what we have, try again when the file changes
+        qWarning() << "RemoteCatalog:" << m_error;
+        if (first) emit changed();
+        return;
+    }
+
+    QList<RemoteInfo> remotes;
+    foreach (QVariant v, result.value("remotes").toList())
+    {
+        QVariantMap map = v.toMap();
+        RemoteInfo info;
+        info.name = map.value("name").toString();
+        info.type = map.value("type").toString();
+        info.options = map.value("options").toMap();
+        remotes << info;
+    }
+
+    //Compare, so that listeners only redraw for real changes
+    bool same = !first && remotes.size() == m_remotes.size();
+    for (int i = 0, ii = remotes.size(); same && i < ii; i++)
+    {
+        const RemoteInfo &a = remotes[i];
+        const RemoteInfo &b = m_remotes[i];
+        same = a.name == b.name && a.type == b.type && a.options == b.options;
+    }
+    if (same) return;
+
+    m_remotes = remotes;
+    m_index.clear();
+    for (int i = 0, ii = m_remotes.size(); i < ii; i++)
+        m_index.insert(m_remotes[i].name, i);
+    emit changed();
+}
+
+void
+RemoteCatalog::watch()
+{
+    //Saving replaces the file (rename), so watch it again
+    QFileInfo file_info(configPath());
+    if (file_info.dir().exists() && !m_watcher->directories().contains(file_info.absolutePath()))
+        m_watcher->addPath(file_info.absolutePath());
+    if (file_info.exists() && !m_watcher->files().contains(file_info.absoluteFilePath()))
+        m_watcher->addPath(file_info.absoluteFilePath());
+}
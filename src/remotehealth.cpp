@@ -0,0 +1,174 @@
+#include "remotehealth.hpp"
+
+QString
+RemoteHealthInfo::summary() const
+{
+    const char *context = "RemoteHealth";
+    switch (status)
+    {
+    case Unknown:
+        return QString();
+    case Ok:
+        return QCoreApplication::translate(context, "ok, %1 ms").arg(latency_ms);
+    case Timeout:
+        return QCoreApplication::translate(context, "not responding");
+    case AuthError:
+        return QCoreApplication::translate(context, "authentication failed");
+    case NotFound:
+        return QCoreApplication::translate(context, "not found");
+    case NetworkError:
+        return QCoreApplication::translate(context, "not reachable");
+    case ConfigError:
+        return QCoreApplication::translate(context, "configuration error");
+    case OtherError:
+        break;
+    }
+    return QCoreApplication::translate(context, "error");
+}
+
+RemoteHealth*
+RemoteHealth::globalInstance()
+{
+    static RemoteHealth *health = new RemoteHealth(qApp);
+    return health;
+}
+
+RemoteHealth::RemoteHealth(QObject *parent)
+            : QObject(parent),
+              m_ttl(300)
+{
+    m_jobs.setMaxRunning(8);
+    m_jobs.setTimeout(15000);
+    connect(&m_jobs, SIGNAL(finished(const QString&, const QVariantMap&)), SLOT(jobFinished(const QString&, const QVariantMap&)));
+}
+
+void
+RemoteHealth::setTimeToLive(int seconds)
+{
+    m_ttl = seconds;
+}
+
+void
+RemoteHealth::setMaxRunning(int count)
+{
+    m_jobs.setMaxRunning(count);
+}
+
+void
+RemoteHealth::setTimeout(int timeout_ms)
+{
+    m_jobs.setTimeout(timeout_ms);
+}
+
+RemoteHealthInfo
+RemoteHealth::health(const QString &remote) const
+{
+    return m_cache.value(remote);
+}
+
+bool
+RemoteHealth::isProbing(const QString &remote) const
+{
+    return m_jobs.isPending(remote);
+}
+
+RemoteHealthInfo::Status
+RemoteHealth::classifyError(const QString &error_output)
+{
+    //rclone error messages, mostly passed through from backend libraries
+    QString text = error_output.toLower();
+    QStringList config_errors, auth_errors, not_found_errors, network_errors;
+    config_errors << "didn't find section in config file" << "couldn't find type of fs"
+        << "failed to create file system" << "unknown backend";
+    auth_errors << "401" << "403" << "unauthorized" << "forbidden" << "invalid_grant"
+        << "invalid_client" << "access denied" << "accessdenied" << "authentication"
+        << "token expired" << "couldn't fetch token" << "signaturedoesnotmatch"
+        << "invalidaccesskeyid" << "permission denied";
+    not_found_errors << "directory not found" << "nosuchbucket" << "bucket not found"
+        << "404" << "not found";
+    network_errors << "no such host" << "connection refused" << "network is unreachable"
+        << "dial tcp" << "i/o timeout" << "tls handshake" << "connection reset"
+        << "no route to host" << "temporary failure in name resolution";
+
+    foreach (const QString &pattern, config_errors)
+        if (text.contains(pattern)) return RemoteHealthInfo::ConfigError;
+    foreach (const QString &pattern, auth_errors)
+        if (text.contains(pattern)) return RemoteHealthInfo::AuthError;
+    foreach (const QString &pattern, network_errors)
+        if (text.contains(pattern)) return RemoteHealthInfo::NetworkError;
+    foreach (const QString &pattern, not_found_errors)
+        if (text.contains(pattern)) return RemoteHealthInfo::NotFound;
+    return RemoteHealthInfo::OtherError;
+}
+
+bool
+RemoteHealth::isListing(const QByteArray &output)
+{
+    QList<QByteArray> lines = output.split('\n');
+    if (lines.size() < 2 || lines[0].trimmed() != "[") return false;
+    QByteArray entry = lines[1].trimmed();
+    if (entry == "]") return true; //empty
+    if (entry.endsWith(',')) entry.chop(1);
+    QJsonParseError error;
+    QJsonDocument j_doc = QJsonDocument::fromJson(entry, &error);
+    return error.error == QJsonParseError::NoError && j_doc.isObject() &&
+        j_doc.object().contains("Path");
+}
+
+bool
+RemoteHealth::probe(const QString &remote, bool force)
+{
+    //Local paths and on-the-fly backends are not probed
+    if (remote.isEmpty() || remote.startsWith('/') || remote.contains(':')) return false;
+
+    //Recent enough, failures as well (don't hammer a broken remote)
+    QHash<QString, RemoteHealthInfo>::const_iterator it = m_cache.constFind(remote);
+    if (!force && it != m_cache.constEnd() &&
+        it.value().time.secsTo(QDateTime::currentDateTimeUtc()) < m_ttl)
+        return false;
+
+    //Top level only, one try: "--retries 1" is a single attempt, no retry
+    //(a failure should be reported, not hidden).
+    //Done after two lines: "[" and the first entry (or "]" if empty).
+    m_jobs.enqueue(remote, QStringList() << "lsjson" << "--max-depth" << "1"
+        << "--no-modtime" << "--no-mimetype"
+        << "--low-level-retries" << "1" << "--retries" << "1" << remote + ":", 2);
+    return true;
+}
+
+void
+RemoteHealth::probe(const QStringList &remotes, bool force)
+{
+    foreach (const QString &remote, remotes)
+        probe(remote, force);
+}
+
+void
+RemoteHealth::jobFinished(const QString &key, const QVariantMap &result)
+{
+    RemoteHealthInfo info;
+    info.time = QDateTime::currentDateTimeUtc();
+    info.latency_ms = result.value("elapsed_ms").toLongLong();
+    if (result.value("ok").toBool())
+    {
+        //Listed, not just exited with 0
+        info.status = RemoteHealthInfo::Ok;
+        if (!isListing(result.value("output").toByteArray()))
+        {
+            info.status = RemoteHealthInfo::OtherError;
+            info.error = tr("Unexpected output");
+        }
+    }
+    else if (result.value("timed_out").toBool())
+    {
+        info.status = RemoteHealthInfo::Timeout;
+    }
+    else
+    {
+        QString error = result.value("error").toString();
+        info.status = classifyError(error);
+        info.error = error.split('\n').last().trimmed();
+    }
+    m_cache[key] = info;
+    emit healthChanged(key);
+}
@@ -0,0 +1,100 @@
+#include "remoteusage.hpp"
+
+QString
+RemoteUsageInfo::summary() const
+{
+    if (!isValid()) return QString();
+    QLocale locale;
+    QStringList parts;
+    if (used >= 0 && total >= 0)
+        parts << QCoreApplication::translate("RemoteUsage", "%1 of %2 used").
+            arg(locale.formattedDataSize(used), locale.formattedDataSize(total));
+    else if (used >= 0)
+        parts << QCoreApplication::translate("RemoteUsage", "%1 used").arg(locale.formattedDataSize(used));
+    if (free >= 0)
+        parts << QCoreApplication::translate("RemoteUsage", "%1 free").arg(locale.formattedDataSize(free));
+    if (objects >= 0)
+        parts << QCoreApplication::translate("RemoteUsage", "%1 objects").arg(objects);
+    return parts.join(", ");
+}
+
+static qint64
+sizeValue(const QJsonObject &j_obj, const QString &key)
+{
+    //Missing if not supported by backend
+    QJsonValue value = j_obj.value(key);
+    if (!value.isDouble()) return -1;
+    return (qint64)value.toDouble();
+}
+
+RemoteUsage*
+RemoteUsage::globalInstance()
+{
+    static RemoteUsage *usage = new RemoteUsage(qApp);
+    return usage;
+}
+
+RemoteUsage::RemoteUsage(QObject *parent)
+           : QObject(parent),
+             m_ttl(600)
+{
+    m_jobs.setTimeout(60000);
+    connect(&m_jobs, SIGNAL(finished(const QString&, const QVariantMap&)), SLOT(jobFinished(const QString&, const QVariantMap&)));
+}
+
+void
+RemoteUsage::setTimeToLive(int seconds)
+{
+    m_ttl = seconds;
+}
+
+void
+RemoteUsage::setMaxRunning(int count)
+{
+    m_jobs.setMaxRunning(count);
+}
+
+RemoteUsageInfo
+RemoteUsage::usage(const QString &remote) const
+{
+    return m_cache.value(remote);
+}
+
+void
+RemoteUsage::request(const QString &remote, bool force)
+{
+    //Local paths and on-the-fly backends have no usage
+    if (remote.isEmpty() || remote.startsWith('/') || remote.contains(':')) return;
+
+    //Recent enough, also after an error (don't retry too often)
+    QHash<QString, RemoteUsageInfo>::const_iterator it = m_cache.constFind(remote);
+    if (!force && it != m_cache.constEnd() &&
+        it.value().time.secsTo(QDateTime::currentDateTimeUtc()) < m_ttl)
+        return;
+
+    m_jobs.enqueue(remote, QStringList() << "about" << "--json" << remote + ":");
+}
+
+void
+RemoteUsage::jobFinished(const QString &key, const QVariantMap &result)
+{
+    RemoteUsageInfo info;
+    info.time = QDateTime::currentDateTimeUtc();
+    if (result.value("ok").toBool())
+    {
+        //{"total": 16106127360, "used": 1234, "free": 16106126126, "objects": 12}
+        QJsonObject j_obj = QJsonDocument::fromJson(result.value("output").toByteArray()).object();
+        info.total = sizeValue(j_obj, "total");
+        info.used = sizeValue(j_obj, "used");
+        info.free = sizeValue(j_obj, "free");
+        info.objects = sizeValue(j_obj, "objects");
+    }
+    else
+    {
+        info.error = result.value("error").toString();
+        if (info.error.isEmpty())
+            info.error = tr("rclone about failed");
+    }
+    m_cache[key] = info;
+    emit usageChanged(key);
+}
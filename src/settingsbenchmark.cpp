@@ -0,0 +1,73 @@
+#include "settingsbenchmark.hpp"
+
+int
+SettingsBenchmark::run(int entries, int iterations)
+{
+    //Separate object, the global settings are not touched and nothing is saved
+    SettingsManager settings;
+    QRandomGenerator *random = QRandomGenerator::global();
+    QElapsedTimer timer;
+    qInfo().noquote() << QString("Settings benchmark: %1 entries, %2 iterations").arg(entries).arg(iterations);
+
+    //Keys are compiled (and cached) like in real use
+    QStringList keys;
+    keys.reserve(entries);
+    for (int i = 0; i < entries; i++)
+        keys << QString("bench.entries.e%1.value").arg(i);
+
+    timer.start();
+    for (int i = 0; i < entries; i++)
+        settings.setVariant(keys[i], i);
+    print("fill", entries, timer.nsecsElapsed());
+
+    //Random reads, O(depth) each
+    timer.restart();
+    for (int i = 0; i < iterations; i++)
+        settings.variant(keys[random->bounded(entries)]);
+    print("read", iterations, timer.nsecsElapsed());
+
+    //Random writes, modified in place
+    timer.restart();
+    for (int i = 0; i < iterations; i++)
+        settings.setVariant(keys[random->bounded(entries)], entries + i);
+    print("write", iterations, timer.nsecsElapsed());
+
+    //Copy-and-replace writes, the whole map is detached every time
+    int copy_iterations = qMax(1, iterations / 100);
+    timer.restart();
+    for (int i = 0; i < copy_iterations; i++)
+    {
+        QString entry_key = QString("e%1").arg(random->bounded(entries));
+        QVariantMap map = settings.variant("bench.entries").toMap();
+        QVariantMap entry = map.value(entry_key).toMap();
+        entry["value"] = -i - 1;
+        map[entry_key] = entry;
+        settings.setVariant("bench.entries", map);
+    }
+    print("write (copy map)", copy_iterations, timer.nsecsElapsed());
+
+    //Whole document, as done by SettingsManager::load():
+    //parsing JSON vs. decoding the binary snapshot
+    QVariantMap document;
+    document["entries"] = settings.variant("bench.entries");
+    QByteArray json = QJsonDocument(QJsonObject::fromVariantMap(document)).toJson();
+    QByteArray cbor = QCborValue::fromVariant(document).toCbor();
+    int load_iterations = qMax(1, iterations / 5000);
+    timer.restart();
+    for (int i = 0; i < load_iterations; i++)
+        QJsonDocument::fromJson(json).object().toVariantMap();
+    print("load (json)", load_iterations, timer.nsecsElapsed());
+    timer.restart();
+    for (int i = 0; i < load_iterations; i++)
+        QCborValue::fromCbor(cbor).toVariant().toMap();
+    print("load (cbor)", load_iterations, timer.nsecsElapsed());
+    return 0;
+}
+
+void
+SettingsBenchmark::print(const QString &test, int count, qint64 nsecs)
+{
+    double us_per_op = nsecs / 1000.0 / qMax(1, count);
+    qInfo().noquote() << QString("  %1 %2 ops %3 us/op").
+        arg(test, -18).arg(count, 8).arg(us_per_op, 10, 'f', 3);
+}
@@ -0,0 +1,207 @@
+#include "settingsjournal.hpp"
+
+void
+SettingsJournal::addMount(const MountConfig &config)
+{
+    record(AddMount, config.mountpoint, config.toVariantMap());
+}
+
+void
+SettingsJournal::setLabel(const QString &mountpoint, const QString &label)
+{
+    record(SetLabel, mountpoint, label);
+}
+
+void
+SettingsJournal::removeMount(const QString &mountpoint)
+{
+    record(RemoveMount, mountpoint, QVariant());
+}
+
+void
+SettingsJournal::setProfile(const QString &mountpoint, const QString &profile)
+{
+    record(SetProfile, mountpoint, profile);
+}
+
+void
+SettingsJournal::setRemotePath(const QString &mountpoint, const QString &path)
+{
+    record(SetRemotePath, mountpoint, path);
+}
+
+void
+SettingsJournal::setAutoMount(const QString &mountpoint, bool enabled)
+{
+    record(SetAutoMount, mountpoint, enabled);
+}
+
+bool
+SettingsJournal::isEmpty() const
+{
+    return m_done.isEmpty();
+}
+
+bool
+SettingsJournal::canUndo() const
+{
+    return !m_done.isEmpty();
+}
+
+bool
+SettingsJournal::canRedo() const
+{
+    return !m_undone.isEmpty();
+}
+
+void
+SettingsJournal::undo()
+{
+    if (m_done.isEmpty()) return;
+    m_undone.append(m_done.takeLast());
+}
+
+void
+SettingsJournal::redo()
+{
+    if (m_undone.isEmpty()) return;
+    m_done.append(m_undone.takeLast());
+}
+
+void
+SettingsJournal::clear()
+{
+    m_done.clear();
+    m_undone.clear();
+}
+
+QList<MountConfig>
+SettingsJournal::apply(QList<MountConfig> list, QStringList *errors) const
+{
+    foreach (const Entry &entry, m_done)
+    {
+        //Find target mount
+        int index = -1;
+        for (int i = 0, ii = list.size(); i < ii; i++)
+        {
+            if (list[i].mountpoint == entry.mountpoint)
+            {
+                index = i;
+                break;
+            }
+        }
+
+        switch (entry.op)
+        {
+        case AddMount:
+            if (index == -1)
+                list.append(MountConfig::fromVariantMap(entry.value.toMap()));
+            else if (errors)
+                *errors << tr("Mountpoint already defined: %1").arg(entry.mountpoint);
+            break;
+        case RemoveMount:
+            if (index != -1)
+                list.removeAt(index);
+            break;
+        case SetLabel:
+        case SetProfile:
+        case SetRemotePath:
+        case SetAutoMount:
+            if (index == -1)
+            {
+                if (errors)
+                    *errors << tr("Mountpoint not defined: %1").arg(entry.mountpoint);
+                break;
+            }
+            if (entry.op == SetLabel)
+                list[index].label = entry.value.toString();
+            else if (entry.op == SetProfile)
+                list[index].profile = entry.value.toString();
+            else if (entry.op == SetRemotePath)
+                list[index].remote_path = entry.value.toString();
+            else
+                list[index].auto_mount = entry.value.toBool();
+            break;
+        }
+    }
+
+    return list;
+}
+
+QStringList
+SettingsJournal::affectedMountpoints() const
+{
+    QStringList list;
+    foreach (const Entry &entry, m_done)
+    {
+        if (!list.contains(entry.mountpoint))
+            list << entry.mountpoint;
+    }
+    return list;
+}
+
+bool
+SettingsJournal::commit(MountSettings *settings, QString *error)
+{
+    //Validate against live settings, nothing is written on conflict
+    QStringList errors;
+    QList<MountConfig> new_list = apply(settings->mounts(), &errors);
+    if (!errors.isEmpty())
+    {
+        if (error) *error = errors.join("\n");
+        return false;
+    }
+
+    //Write delta, only affected mounts, in one batch
+    QStringList affected_list = affectedMountpoints();
+    QSet<QString> affected(affected_list.begin(), affected_list.end());
+    QList<MountConfig> updated;
+    foreach (const MountConfig &cfg, new_list)
+    {
+        if (affected.remove(cfg.mountpoint))
+            updated << cfg;
+    }
+
+    //Edited mounts must be complete, nothing is written otherwise
+    foreach (const MountConfig &cfg, updated)
+    {
+        foreach (const QString &cfg_error, cfg.validate())
+            errors << QString("%1: %2").arg(cfg.mountpoint, cfg_error);
+    }
+    if (!errors.isEmpty())
+    {
+        if (error) *error = errors.join("\n");
+        return false;
+    }
+
+    //Rolled back to the state before (document and dirty flag) on failure,
+    //the journal is kept, so the same changes can be committed again
+    SettingsDocument old_document = settings->document();
+    bool old_dirty = settings->isDirty();
+    if (!settings->updateMounts(updated, affected.values())) //remaining: removed
+    {
+        settings->restoreDocument(old_document, old_dirty);
+        if (error) *error = tr("Mountpoint already defined");
+        return false;
+    }
+    if (!settings->save())
+    {
+        settings->restoreDocument(old_document, old_dirty);
+        if (error) *error = tr("Cannot write config file %1\n(not writable or changed by another program)").
+            arg(settings->configFileInfo().filePath());
+        return false;
+    }
+    clear();
+    return true;
+}
+
+void
+SettingsJournal::record(Operation op, const QString &mountpoint, const QVariant &value)
+{
+    Entry entry;
+    entry.op = op;
+    entry.mountpoint = mountpoint;
+    entry.value = value;
+    m_done.append(entry);
+    m_undone.clear(); //new branch
+}
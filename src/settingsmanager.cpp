@@ -1,5 +1,22 @@
 #include "settingsmanager.hpp"
 
+SettingsKey::SettingsKey()
+           : m_serial(0)
+{
+}
+
+bool
+SettingsKey::isValid() const
+{
+    return !m_item_key.isEmpty();
+}
+
+QString
+SettingsKey::key() const
+{
+    return m_key;
+}
+
 void
 SettingsManager::setOrganizationName(const QString &organization)
 {
@@ -21,6 +38,43 @@ SettingsManager::setDefaultGroup(const QString &group_name)
     map["default_group"] = group_name;
 }
 
+SettingsDocumentData::SettingsDocumentData()
+                    : revision(0)
+{
+}
+
+SettingsDocument::SettingsDocument()
+                : d(new SettingsDocumentData)
+{
+}
+
+const QVariantMap&
+SettingsDocument::constMap() const
+{
+    return d.constData()->map;
+}
+
+QVariantMap&
+SettingsDocument::map()
+{
+    //Every writer gets a new revision (may be written through reference)
+    static quint64 revision_counter = 0;
+    d->revision = ++revision_counter; //detaches
+    return d->map;
+}
+
+quint64
+SettingsDocument::revision() const
+{
+    return d.constData()->revision;
+}
+
+void
+SettingsDocument::swap(SettingsDocument &other)
+{
+    d.swap(other.d);
+}
+
 SettingsManager*
 SettingsManager::globalInstance()
 {
@@ -29,7 +83,10 @@ SettingsManager::globalInstance()
 }
 
 SettingsManager::SettingsManager()
-               : m_data(0)
+               : m_data(0),
+                 m_tmr_save(0),
+                 m_own_notifier(false),
+                 m_key_serial(nextKeySerial())
 {
     m_state = stateMap(); //copy global settings
 
@@ -38,21 +95,17 @@ SettingsManager::SettingsManager()
 
     //Load config
     configDirectory(true); //create dir
-    QFile file(configFileInfo().filePath());
-    if (file.open(QIODevice::ReadOnly))
-    {
-        QByteArray raw = file.readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(raw);
-        QJsonObject j_obj = doc.object();
-        *m_data = j_obj.toVariantMap();
-    }
-    m_state["dirty"] = false;
+    load();
 
 }
 
 SettingsManager::SettingsManager(const SettingsManager &other)
                : m_state(other.m_state),
-                 m_data_obj(*other.m_data)
+                 m_data_obj(*other.m_data),
+                 m_tmr_save(0),
+                 m_own_notifier(false),
+                 m_key_cache(other.m_key_cache),
+                 m_key_serial(other.m_key_serial)
 {
     //Explicit copy constructor - even though we sometimes want
     //the same behavior that we'd have with the implicit one,
@@ -65,6 +118,29 @@ SettingsManager::SettingsManager(const SettingsManager &other)
     m_data = &m_data_obj;
 }
 
+SettingsManager::~SettingsManager()
+{
+    delete m_tmr_save;
+    if (m_own_notifier)
+        delete m_notifier;
+}
+
+SettingsManager&
+SettingsManager::operator=(const SettingsManager &other)
+{
+    //Same as copy constructor: copy user data, don't share the
+    //data pointer (group accessor) or the save timer of other
+    if (this == &other) return *this;
+    m_state = other.m_state;
+    m_data_obj = *other.m_data;
+    m_data = &m_data_obj;
+    m_key_cache = other.m_key_cache;
+    m_key_serial = other.m_key_serial;
+    if (m_tmr_save) m_tmr_save->stop();
+    notifyChanged(); //all data replaced
+    return *this;
+}
+
 QDir
 SettingsManager::configDirectory(bool create) const
 {
@@ -169,6 +245,26 @@ SettingsManager::hasVariantPrefix() const
     return use_q_prefix;
 }
 
+bool
+SettingsManager::hasBinaryCache() const
+{
+    return m_state.value("use_binary_cache").toBool();
+}
+
+void
+SettingsManager::setInitBinaryCache(bool use_cache)
+{
+    QVariantMap &global_state = stateMap(); //global
+    global_state["use_binary_cache"] = use_cache;
+}
+
+QFileInfo
+SettingsManager::cacheFileInfo() const
+{
+    QFileInfo file_info = configFileInfo();
+    return QFileInfo(file_info.dir(), file_info.completeBaseName() + ".cbor");
+}
+
 void
 SettingsManager::setInitVariantPrefix(bool use_prefix)
 {
@@ -180,13 +276,16 @@ void
 SettingsManager::enableVariantPrefix(bool use_prefix)
 {
     m_state["use_variant_prefix"] = use_prefix;
+    invalidateKeys();
 
     if (use_prefix)
     {
-        if (!m_data->contains("Q"))
+        if (!data().contains("Q"))
         {
             //Add prefix object
-            (*m_data)["Q"] = QVariantMap();
+            mutableData()["Q"] = QVariantMap();
+            m_state["dirty"] = true;
+            notifyChanged(QStringList(), "Q");
         }
     }
 }
@@ -198,8 +297,10 @@ SettingsManager::groupAccessor(const QString &name, bool modify_parent)
     if (modify_parent)
     {
         group_accessor.m_data = m_data;
+        group_accessor.m_notifier = notifier();
     }
     group_accessor.m_state["group_name"] = name; //set current group
+    group_accessor.invalidateKeys();
     return group_accessor;
 }
 
@@ -208,10 +309,17 @@ SettingsManager::variant(const QString &key, const QVariant &default_value) cons
 {
     //Path to requested dict element
     if (key.isEmpty()) return QVariant(); //don't return full map
-    QStringList dict_keys = splitItemKey(key).first;
-    QString item_key = splitItemKey(key).second;
+    return variant(compileKey(key), default_value);
+}
 
-    return variant(dict_keys, item_key, default_value);
+QVariant
+SettingsManager::variant(const SettingsKey &key, const QVariant &default_value) const
+{
+    if (!key.isValid()) return QVariant();
+    if (key.m_serial != m_key_serial)
+        return variant(compileKey(key.m_key), default_value); //other state
+
+    return variant(key.m_dict_keys, key.m_item_key, default_value);
 }
 
 void
@@ -219,10 +327,59 @@ SettingsManager::setVariant(const QString &key, const QVariant &value)
 {
     //Path to requested dict element
     if (key.isEmpty()) return; //don't update full map (only one element)
-    QStringList dict_keys = splitItemKey(key).first;
-    QString item_key = splitItemKey(key).second;
+    setVariant(compileKey(key), value);
+}
+
+void
+SettingsManager::setVariant(const SettingsKey &key, const QVariant &value)
+{
+    if (!key.isValid()) return;
+    if (key.m_serial != m_key_serial)
+    {
+        setVariant(compileKey(key.m_key), value); //other state
+        return;
+    }
+
+    setVariant(key.m_dict_keys, key.m_item_key, value);
+}
 
-    setVariant(dict_keys, item_key, value);
+SettingsKey
+SettingsManager::compileKey(const QString &key) const
+{
+    QHash<QString, SettingsKey>::const_iterator it = m_key_cache.constFind(key);
+    if (it != m_key_cache.constEnd())
+        return it.value();
+
+    SettingsKey compiled;
+    if (key.isEmpty()) return compiled; //invalid
+    QPair<QStringList, QString> pair = splitItemKey(key);
+    compiled.m_key = key;
+    compiled.m_dict_keys = pair.first;
+    compiled.m_item_key = pair.second;
+    compiled.m_serial = m_key_serial;
+    m_key_cache.insert(key, compiled);
+    return compiled;
+}
+
+SettingsNotifier*
+SettingsManager::notifier()
+{
+    if (!m_notifier)
+    {
+        m_notifier = new SettingsNotifier;
+        m_own_notifier = true;
+    }
+    return m_notifier;
+}
+
+bool
+SettingsManager::subscribe(const QString &key, QObject *receiver, const char *member)
+{
+    //Subscribe to the full path, as reported by setVariant()
+    SettingsKey compiled = compileKey(key);
+    if (!compiled.isValid()) return false;
+    QString path = QStringList(compiled.m_dict_keys + QStringList(compiled.m_item_key)).join('.');
+    return notifier()->subscribe(path, receiver, member);
 }
 
 //QVariant
@@ -237,43 +394,218 @@ SettingsManager::keys(const QString &key, bool with_sub_maps) const
 {
     //Path to requested dict element
     QStringList dict_keys = splitItemKey(key).first;
-    QString item_key = splitItemKey(key).second;
 
-    //Get each nested map
-    QVariantMap cur_map = *m_data;
-    foreach (QString dict_key, dict_keys)
+    //Walk nested maps in place
+    const QVariantMap *cur_map = &data();
+    foreach (const QString &dict_key, dict_keys)
     {
-        cur_map = cur_map.value(dict_key).toMap();
+        cur_map = constChildMap(cur_map, dict_key);
+        if (!cur_map) return QStringList();
     }
 
-    return cur_map.keys();
+    return cur_map->keys();
+}
+
+bool
+SettingsManager::load()
+{
+    m_state["dirty"] = false;
+    QFile file(configFileInfo().filePath());
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray raw = file.readAll();
+    QByteArray hash = QCryptographicHash::hash(raw, QCryptographicHash::Sha1);
+    qint64 mtime = configFileInfo().lastModified().toMSecsSinceEpoch();
+    m_state["file_hash"] = hash;
+
+    //Binary snapshot, only valid for this exact JSON file
+    if (hasBinaryCache())
+    {
+        QFile cache_file(cacheFileInfo().filePath());
+        if (cache_file.open(QIODevice::ReadOnly))
+        {
+            QCborMap cache = QCborValue::fromCbor(cache_file.readAll()).toMap();
+            if (cache.value(QString("json_hash")).toByteArray() == hash &&
+                cache.value(QString("json_mtime")).toInteger() == mtime)
+            {
+                //Decoded directly, numbers are stored as doubles like in JSON
+                //(see writeCache()), so types are the same as when parsing
+                mutableData() = cache.value(QString("data")).toVariant().toMap();
+                notifyChanged();
+                return true;
+            }
+        }
+    }
+
+    //Parse JSON, cache is missing or stale
+    QJsonDocument doc = QJsonDocument::fromJson(raw);
+    QJsonObject j_obj = doc.object();
+    mutableData() = j_obj.toVariantMap();
+    if (hasBinaryCache())
+        writeCache(data(), hash, mtime);
+    notifyChanged();
+    return true;
+}
+
+QVariantMap
+SettingsManager::readConfigFile(const QString &path)
+{
+    QVariantMap result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return result;
+    QByteArray raw = file.readAll();
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(raw, &error);
+    if (error.error != QJsonParseError::NoError) return result;
+
+    result["ok"] = true;
+    result["hash"] = QCryptographicHash::hash(raw, QCryptographicHash::Sha1);
+    result["data"] = doc.object().toVariantMap();
+    return result;
+}
+
+bool
+SettingsManager::setLoadedData(const QVariantMap &data, const QByteArray &file_hash, bool discard_changes)
+{
+    //Unsaved changes are not replaced, unless the caller decided so
+    if (isDirty() && !discard_changes) return false;
+    mutableData() = data;
+    m_state["file_hash"] = file_hash;
+    m_state["dirty"] = false;
+    notifyChanged();
+    return true;
+}
+
+QByteArray
+SettingsManager::fileHash() const
+{
+    return m_state.value("file_hash").toByteArray();
+}
+
+void
+SettingsManager::setFileHash(const QByteArray &file_hash)
+{
+    m_state["file_hash"] = file_hash;
 }
 
 bool
 SettingsManager::save()
 {
+    if (m_tmr_save) m_tmr_save->stop();
+    //Nothing changed since load or last save
+    if (!isDirty() && configFileInfo().exists()) return true;
+
+    //Changed by another program since load or last save, not overwritten
+    //(see setLoadedData() and setFileHash())
+    QFile old_file(configFileInfo().filePath());
+    if (!fileHash().isEmpty() && old_file.open(QIODevice::ReadOnly))
+    {
+        QByteArray old_hash = QCryptographicHash::hash(old_file.readAll(), QCryptographicHash::Sha1);
+        old_file.close();
+        if (old_hash != fileHash())
+        {
+            qWarning() << "Config file has been changed by another program, not saved:" << old_file.fileName();
+            return false;
+        }
+    }
+
     //Serialize variant map into JSON structure (object at the top)
-    QJsonObject j_obj = QJsonObject::fromVariantMap(*m_data);
+    QJsonObject j_obj = QJsonObject::fromVariantMap(data());
     QJsonDocument j_doc = QJsonDocument(j_obj);
-    //Open config file
-    QFile file(configFileInfo().filePath());
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
-    //Write to file
+    //Write to temporary file next to config file
+    QSaveFile file(configFileInfo().filePath());
+    if (!file.open(QIODevice::WriteOnly)) return false;
     QByteArray raw = j_doc.toJson(QJsonDocument::Indented);
-    if (file.write(raw) == -1) return false;
+    if (file.write(raw) == -1)
+    {
+        file.cancelWriting();
+        return false;
+    }
+    //Sync to disk and rename over old config file
+    if (!file.commit()) return false;
+    QByteArray hash = QCryptographicHash::hash(raw, QCryptographicHash::Sha1);
+    m_state["file_hash"] = hash;
+    if (hasBinaryCache())
+        writeCache(j_obj.toVariantMap(), hash, configFileInfo().lastModified().toMSecsSinceEpoch());
 
     m_state["dirty"] = false;
     return true;
 }
 
+bool
+SettingsManager::writeCache(const QVariantMap &data, const QByteArray &hash, qint64 mtime) const
+{
+    //Same data as JSON file. Converted from variants, not from QJsonObject,
+    //which would store whole numbers as integers (JSON numbers are doubles)
+    QCborMap cache;
+    cache.insert(QString("json_hash"), hash);
+    cache.insert(QString("json_mtime"), mtime);
+    cache.insert(QString("data"), QCborValue::fromVariant(data));
+
+    QSaveFile file(cacheFileInfo().filePath());
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    if (file.write(cache.toCborValue().toCbor()) == -1)
+    {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+void
+SettingsManager::saveLater(int delay_ms)
+{
+    if (!m_tmr_save)
+    {
+        m_tmr_save = new QTimer;
+        m_tmr_save->setSingleShot(true);
+        QObject::connect(m_tmr_save, &QTimer::timeout, [this]() { save(); });
+    }
+    m_tmr_save->start(delay_ms);
+}
+
+bool
+SettingsManager::flush()
+{
+    return save();
+}
+
+bool
+SettingsManager::isDirty() const
+{
+    return m_state.value("dirty").toBool();
+}
+
+SettingsDocument
+SettingsManager::document() const
+{
+    return *m_data;
+}
+
+void
+SettingsManager::restoreDocument(const SettingsDocument &document, bool dirty)
+{
+    *m_data = document;
+    m_state["dirty"] = dirty;
+    notifyChanged();
+}
+
 void
 SettingsManager::replaceWith(const SettingsManager &other)
 {
     //Replace our data (dict) with that of other
     //other->m_data points to the data of other
     //we replace our local map and reset our m_data pointer TODO this may not always be good
+    //Documents are shared, so this is a pointer assignment, not a copy.
     m_data_obj = *other.m_data;
     m_data = &m_data_obj; //TODO write to m_data!?
+    m_state["dirty"] = true;
+    notifyChanged();
+}
+
+quint64
+SettingsManager::revision() const
+{
+    return m_data->revision();
 }
 
 QVariant
@@ -281,15 +613,17 @@ SettingsManager::variant(const QStringList &dict_keys, const QString &item_key,
 {
     assert(!item_key.isEmpty());
 
-    //Get each nested map
-    QVariantMap cur_map = *m_data;
-    foreach (QString dict_key, dict_keys)
+    //Walk nested maps in place, no copies
+    const QVariantMap *cur_map = &data();
+    foreach (const QString &dict_key, dict_keys)
     {
-        cur_map = cur_map.value(dict_key).toMap();
+        cur_map = constChildMap(cur_map, dict_key);
+        if (!cur_map) return default_value;
     }
 
-    if (cur_map.contains(item_key))
-        return cur_map.value(item_key);
+    QVariantMap::const_iterator it = cur_map->constFind(item_key);
+    if (it != cur_map->constEnd())
+        return it.value();
     else
         return default_value;
 }
@@ -299,67 +633,58 @@ SettingsManager::setVariant(const QStringList &dict_keys, const QString &item_ke
 {
     assert(!item_key.isEmpty());
 
-    //Get each nested map
-    QList<QPair<QString, QVariantMap>> sub_dict_map;
-    QVariantMap cur_map = *m_data;
-    foreach (QString dict_key, dict_keys)
+    //Same value, no change (no copy, not dirty, no notification)
+    QVariant old_value = variant(dict_keys, item_key, QVariant());
+    if (old_value.isValid() && old_value == value) return;
+
+    //Walk nested maps by reference, creating missing ones.
+    //Each level is modified in place, so only a level that is still
+    //shared with a copy of this object gets detached (copied).
+    QVariantMap *cur_map = &mutableData();
+    foreach (const QString &dict_key, dict_keys)
     {
-        cur_map = cur_map.value(dict_key).toMap();
-        QPair<QString, QVariantMap> level(dict_key, cur_map);
-        sub_dict_map.append(level);
+        cur_map = childMap(cur_map, dict_key);
     }
-    assert(sub_dict_map.size() == dict_keys.size());
 
     //Update map at requested level, insert or update map element
-    cur_map[item_key] = value;
-
-    //Now, we need to copy each nested dict (again)
-    //and put them all together.
-    //(We would not really have to do that if we'd be limited to one level.)
-    //(But having only one level would be boring.)
-    //(One level could be simplified to: QMap -> QVariantMap -> QJsonObject)
-    //For example, the user might have requested to update the nested
-    //dict at [Q, dbs, db1]: Q.dbs.db1.dsn = <dsn>
-    //It would be easier if we could get each nested map as reference,
-    //use it to get the next map from it and modify that last map:
-    //https://stackoverflow.com/q/11090846
-
-    //Recreate nested dictionary from bottom to top
-    //mod_dict will be the new dictionary directly in full dict
-    QVariantMap mod_dict = cur_map; //copy modified map
-    for (int i = sub_dict_map.size() - 1; i > 0; i--)
-    {
-        //Copy parent dict and insert/update modified dict
-        QString dict_key = sub_dict_map[i].first; //current key
-        QVariantMap dict = sub_dict_map[i - 1].second; //parent dict
-        dict[dict_key] = mod_dict; //put modified dict in parent dict
-        mod_dict = dict; //copy updated parent dict for next iteration
-    }
-    if (!dict_keys.isEmpty())
-    {
-        //Update dict in full map
-        QString mod_dict_key = sub_dict_map[0].first;
-        (*m_data)[mod_dict_key] = mod_dict;
-    }
-    else
-    {
-        //Update full map
-        *m_data = mod_dict;
-    }
+    (*cur_map)[item_key] = value;
 
     m_state["dirty"] = true;
+    notifyChanged(dict_keys, item_key);
 }
 
 QVariantMap
 SettingsManager::fullMap() const
 {
-    return *m_data; //copy of full settings map
+    return data(); //copy of full settings map (shared)
 }
 
 void
 SettingsManager::setFullMap(const QVariantMap &value)
 {
-    *m_data = value; //replace full settings map
+    mutableData() = value; //replace full settings map
+    m_state["dirty"] = true;
+    notifyChanged();
+}
+
+const QVariantMap*
+SettingsManager::constChildMap(const QVariantMap *map, const QString &key)
+{
+    QVariantMap::const_iterator it = map->constFind(key);
+    if (it == map->constEnd()) return 0;
+    const QVariant &value = it.value();
+    if (value.userType() != QMetaType::QVariantMap) return 0;
+    return static_cast<const QVariantMap*>(value.constData());
+}
+
+QVariantMap*
+SettingsManager::childMap(QVariantMap *map, const QString &key)
+{
+    //Reference to value within parent map, replaced if not a map
+    QVariant &value = (*map)[key];
+    if (value.userType() != QMetaType::QVariantMap)
+        value = QVariantMap();
+    return static_cast<QVariantMap*>(value.data());
 }
 
 QPair<QStringList, QString>
@@ -403,6 +728,36 @@ SettingsManager::splitItemKey(const QString &key, bool use_default_group) const
     return pair;
 }
 
+const QVariantMap&
+SettingsManager::data() const
+{
+    return m_data->constMap();
+}
+
+QVariantMap&
+SettingsManager::mutableData()
+{
+    return m_data->map();
+}
+
+void
+SettingsManager::invalidateKeys()
+{
+    m_key_cache.clear();
+    m_key_serial = nextKeySerial();
+}
+
+void
+SettingsManager::notifyChanged(const QStringList &dict_keys, const QString &item_key)
+{
+    //Nobody has subscribed yet, nothing to collect
+    if (!m_notifier) return;
+    if (item_key.isEmpty())
+        m_notifier->notify("");
+    else
+        m_notifier->notify(QStringList(dict_keys + QStringList(item_key)).join('.'));
+}
+
 QVariantMap&
 SettingsManager::stateMap()
 {
@@ -411,3 +766,9 @@ SettingsManager::stateMap()
     return map;
 }
 
+quint64
+SettingsManager::nextKeySerial()
+{
+    static quint64 serial = 0;
+    return ++serial;
+}
@@ -0,0 +1,102 @@
+#include "settingsnotifier.hpp"
+
+SettingsNotifier::SettingsNotifier(QObject *parent)
+                : QObject(parent),
+                  m_scheduled(false)
+{
+}
+
+bool
+SettingsNotifier::subscribe(const QString &path, QObject *receiver, const char *member)
+{
+    if (!receiver || !member || !*member) return false;
+
+    //SLOT(name(args)) => "1name(args)", skip type code
+    QByteArray signature = QMetaObject::normalizedSignature(member + 1);
+    int index = receiver->metaObject()->indexOfMethod(signature);
+    if (index == -1)
+    {
+        qWarning() << "SettingsNotifier: no such method:" << signature;
+        return false;
+    }
+
+    Subscription subscription;
+    subscription.path = path;
+    subscription.receiver = receiver;
+    subscription.method = receiver->metaObject()->method(index);
+    m_subscriptions.append(subscription);
+    return true;
+}
+
+void
+SettingsNotifier::unsubscribe(QObject *receiver, const QString &path)
+{
+    for (int i = m_subscriptions.size() - 1; i >= 0; i--)
+    {
+        const Subscription &subscription = m_subscriptions[i];
+        if (subscription.receiver != receiver) continue;
+        if (!path.isEmpty() && subscription.path != path) continue;
+        m_subscriptions.removeAt(i);
+    }
+}
+
+void
+SettingsNotifier::notify(const QString &path)
+{
+    if (!m_pending.contains(path))
+        m_pending << path;
+
+    //One delivery per event loop iteration
+    if (m_scheduled) return;
+    m_scheduled = true;
+    QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+}
+
+bool
+SettingsNotifier::affects(const QString &changed_path, const QString &subscribed_path)
+{
+    //Whole document, same value, value below or map above subscribed path
+    if (changed_path.isEmpty() || changed_path == subscribed_path)
+        return true;
+    if (subscribed_path.startsWith(changed_path + '.'))
+        return true;
+    return changed_path.startsWith(subscribed_path + '.');
+}
+
+void
+SettingsNotifier::deliver()
+{
+    //Changes made by subscribers are delivered in the next iteration
+    m_scheduled = false;
+    QStringList paths = m_pending;
+    m_pending.clear();
+    if (paths.isEmpty()) return;
+
+    emit changed(paths);
+
+    //Copy, a subscriber may (un)subscribe while being called
+    QList<Subscription> subscriptions = m_subscriptions;
+    foreach (const Subscription &subscription, subscriptions)
+    {
+        if (!subscription.receiver) continue;
+        QStringList affected;
+        foreach (const QString &path, paths)
+        {
+            if (affects(path, subscription.path))
+                affected << path;
+        }
+        if (affected.isEmpty()) continue;
+
+        if (subscription.method.parameterCount() == 1)
+            subscription.method.invoke(subscription.receiver, Qt::DirectConnection, Q_ARG(QStringList, affected));
+        else
+            subscription.method.invoke(subscription.receiver, Qt::DirectConnection);
+    }
+
+    //Forget destroyed receivers
+    for (int i = m_subscriptions.size() - 1; i >= 0; i--)
+    {
+        if (!m_subscriptions[i].receiver)
+            m_subscriptions.removeAt(i);
+    }
+}
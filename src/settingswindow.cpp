@@ -2,12 +2,12 @@
 
 SettingsWindow::SettingsWindow(MountSettings *settings, QWidget *parent)
               : QDialog(parent),
-                m_settings(settings)
+                m_settings(settings),
+                m_btn_undo(0),
+                m_btn_redo(0)
 {
-    //List of mount config items
-    //They are copied here and the copy is modified
-    //until the user confirms.
-    m_settings_new = *settings;
+    //Changes to mount config items are recorded in a journal
+    //and only applied to the settings when the user confirms.
 
     //Main layout
     QVBoxLayout *vbox = new QVBoxLayout;
@@ -20,13 +20,27 @@ SettingsWindow::SettingsWindow(MountSettings *settings, QWidget *parent)
     m_tab_widget->addTab(wid_conns, tr("Connections"));
     QVBoxLayout *vbox_conns = new QVBoxLayout;
     wid_conns->setLayout(vbox_conns);
+    //Filter for both frames
+    m_txt_filter = new QLineEdit;
+    m_txt_filter->setPlaceholderText(tr("Filter..."));
+    m_txt_filter->setClearButtonEnabled(true);
+    connect(m_txt_filter, SIGNAL(textChanged(const QString&)), SLOT(filterItems()));
+    vbox_conns->addWidget(m_txt_filter);
     //Mountpoints frame
     QGroupBox *grp_mounts = new QGroupBox(tr("Configured Mountpoints"));
     vbox_conns->addWidget(grp_mounts);
     QVBoxLayout *vbox1 = new QVBoxLayout;
     grp_mounts->setLayout(vbox1);
-    m_wid_mounts = new QWidget;
-    vbox1->addWidget(m_wid_mounts);
+    m_mdl_mounts = new ItemListModel(this);
+    m_lst_mounts = new ItemListView(m_mdl_mounts);
+    m_lst_mounts->itemDelegate()->setMenuIndicator(true);
+    m_lst_mounts->itemDelegate()->setStateColors(0, QColor("lightGray"), QColor("black"), QColor("steelblue"), QColor("white"));
+    connect(m_lst_mounts, SIGNAL(menuRequested(const QString&, const QPoint&)), SLOT(showMountMenu(const QString&, const QPoint&)));
+    vbox1->addWidget(m_lst_mounts);
+    m_btn_no_mounts = new ItemButton(
+        tr("(No mountpoints configured. Select a connection to mount it.)"),
+        true);
+    vbox1->addWidget(m_btn_no_mounts);
     //Connections frame
     QGroupBox *grp_conns = new QGroupBox(tr("Available Connections"));
     vbox_conns->addWidget(grp_conns);
@@ -34,9 +48,17 @@ SettingsWindow::SettingsWindow(MountSettings *settings, QWidget *parent)
     grp_conns->setLayout(vbox2);
     m_wid_conns = new QWidget;
     vbox2->addWidget(m_wid_conns);
+    QVBoxLayout *vbox_conn_btns = new QVBoxLayout;
+    vbox_conn_btns->setSpacing(vbox_conn_btns->spacing() + 5);
+    m_wid_conns->setLayout(vbox_conn_btns);
+    m_btn_no_conns = new ItemButton("", true);
+    m_btn_no_conns->setDisabled(true);
+    vbox_conn_btns->addWidget(m_btn_no_conns);
     //Initialize both frames
     loadMountsFrame();
     loadConnectionsFrame();
+    connect(RemoteCatalog::globalInstance(), SIGNAL(changed()), SLOT(loadConnectionsFrame()));
+    connect(RemoteHealth::globalInstance(), SIGNAL(healthChanged(const QString&)), SLOT(healthChanged(const QString&)));
 
     QWidget *wid_settings = new QWidget;
     m_tab_widget->addTab(wid_settings, tr("General"));
@@ -48,6 +70,13 @@ SettingsWindow::SettingsWindow(MountSettings *settings, QWidget *parent)
     settings_box->addRow(tr("Path to rclone"), txt_rclone_path);
 
     QHBoxLayout *hbox = new QHBoxLayout;
+    m_btn_undo = new QPushButton(tr("&Undo"));
+    connect(m_btn_undo, SIGNAL(clicked()), SLOT(undo()));
+    hbox->addWidget(m_btn_undo);
+    m_btn_redo = new QPushButton(tr("&Redo"));
+    connect(m_btn_redo, SIGNAL(clicked()), SLOT(redo()));
+    hbox->addWidget(m_btn_redo);
+    hbox->addStretch();
     QPushButton *btn_save = new QPushButton(tr("&Save"));
     connect(btn_save, SIGNAL(clicked()), SLOT(save()));
     hbox->addWidget(btn_save);
@@ -55,33 +84,68 @@ SettingsWindow::SettingsWindow(MountSettings *settings, QWidget *parent)
     connect(btn_close, SIGNAL(clicked()), SLOT(close()));
     hbox->addWidget(btn_close);
     vbox->addLayout(hbox);
+    updateJournalButtons();
 
 }
 
-QList<QVariantMap>
+QList<MountConfig>
 SettingsWindow::result()
 {
-    return m_settings_new.mountConfigList();
+    return mountConfigList();
 }
 
 void
 SettingsWindow::save()
 {
-    //Save new mountpoint configurations
-    if (m_settings)
+    //Save new mountpoint configurations (all or nothing)
+    QStringList affected = m_journal.affectedMountpoints();
+    if (m_settings && !m_journal.isEmpty())
     {
-        //m_settings->setMountConfigList(m_mounts);
-        m_settings->replaceWith(m_settings_new);
-        m_settings->save();
+        QString error;
+        if (!m_journal.commit(m_settings, &error))
+        {
+            QMessageBox::critical(this, tr("Cannot save"),
+                tr("The configuration cannot be saved:\n%1").arg(error));
+            return;
+        }
     }
 
     //Send signal for main window to show new configuration
     emit savedSignal();
-    emit mountsSavedSignal();
+    emit mountsSavedSignal(affected);
 
     close();
 }
 
+void
+SettingsWindow::undo()
+{
+    m_journal.undo();
+    loadMountsFrame();
+}
+
+void
+SettingsWindow::redo()
+{
+    m_journal.redo();
+    loadMountsFrame();
+}
+
+void
+SettingsWindow::updateJournalButtons()
+{
+    if (!m_btn_undo) return; //not yet created
+    m_btn_undo->setEnabled(m_journal.canUndo());
+    m_btn_redo->setEnabled(m_journal.canRedo());
+}
+
+QList<MountConfig>
+SettingsWindow::mountConfigList()
+{
+    //Live configuration with pending changes
+    return m_journal.apply(m_settings->mounts());
+}
+
 void
 SettingsWindow::closeEvent(QCloseEvent *event)
 {
@@ -91,71 +155,136 @@ SettingsWindow::closeEvent(QCloseEvent *event)
 void
 SettingsWindow::loadMountsFrame()
 {
-    foreach (QObject *child, m_wid_mounts->children())
-        child->deleteLater();
-    QVBoxLayout *vbox = new QVBoxLayout;
-    delete m_wid_mounts->layout();
-    m_wid_mounts->setLayout(vbox);
-
-    QStringList mountpoints = getMountpoints();
-    foreach (QString mountpoint, mountpoints)
-    {
-        QVariantMap info = getMountpointInfo(mountpoint);
-        QString conn_name = info.value("connection").toString();
-        ItemButton *itm_mount = new ItemButton(mountpoint);
-        itm_mount->setSubtitle(conn_name);
-        itm_mount->setHoverBgColor("steelblue");
-        vbox->addWidget(itm_mount);
-        vbox->addSpacing(5);
-        QAction *act_rename = itm_mount->addAction(tr("Rename"));
-        act_rename->setData(mountpoint);
-        connect(act_rename, SIGNAL(triggered()), SLOT(renameItem()));
-        QAction *act_remove = itm_mount->addAction(tr("Remove"));
-        act_remove->setData(mountpoint);
-        connect(act_remove, SIGNAL(triggered()), SLOT(removeItem()));
-        QAction *act_umount = itm_mount->addAction(tr("Unmount"));
-        act_umount->setData(mountpoint);
-        connect(act_umount, SIGNAL(triggered()), SLOT(umountItem()));
-    }
-    if (mountpoints.isEmpty())
+    //Journal replayed once, not once per mountpoint
+    QList<MountConfig> list = mountConfigList();
+    QList<ItemListModel::Item> items;
+    foreach (const MountConfig &cfg, list)
     {
-        ItemButton *itm_mount = new ItemButton(
-            tr("(No mountpoints configured. Select a connection to mount it.)"),
-            true);
-        vbox->addWidget(itm_mount);
-        vbox->addSpacing(5);
+        ItemListModel::Item item;
+        item.key = cfg.mountpoint;
+        item.title = cfg.mountpoint;
+        item.subtitle = mountSubtitle(cfg);
+        item.keywords = cfg.label + "\n" + cfg.connection;
+        items << item;
     }
+    m_mdl_mounts->updateItems(items); //only rows that differ
+    m_lst_mounts->setVisible(!list.isEmpty());
+    m_btn_no_mounts->setVisible(list.isEmpty());
 
+    updateJournalButtons();
+}
+
+void
+SettingsWindow::showMountMenu(const QString &mountpoint, const QPoint &pos)
+{
+    MountConfig info = getMountpointInfo(mountpoint);
+    QMenu menu;
+    QAction *act_rename = menu.addAction(tr("Rename"));
+    act_rename->setData(mountpoint);
+    connect(act_rename, SIGNAL(triggered()), SLOT(renameItem()));
+    QAction *act_remove = menu.addAction(tr("Remove"));
+    act_remove->setData(mountpoint);
+    connect(act_remove, SIGNAL(triggered()), SLOT(removeItem()));
+    QAction *act_profile = menu.addAction(tr("Profile"));
+    act_profile->setData(mountpoint);
+    connect(act_profile, SIGNAL(triggered()), SLOT(changeProfile()));
+    QAction *act_path = menu.addAction(tr("Remote path"));
+    act_path->setData(mountpoint);
+    connect(act_path, SIGNAL(triggered()), SLOT(changeRemotePath()));
+    QAction *act_auto = menu.addAction(tr("Mount on startup"));
+    act_auto->setData(mountpoint);
+    act_auto->setCheckable(true);
+    act_auto->setChecked(info.auto_mount);
+    connect(act_auto, SIGNAL(triggered()), SLOT(toggleAutoMount()));
+    QAction *act_umount = menu.addAction(tr("Unmount"));
+    act_umount->setData(mountpoint);
+    connect(act_umount, SIGNAL(triggered()), SLOT(umountItem()));
+    menu.exec(pos);
+}
+
+QString
+SettingsWindow::mountSubtitle(const MountConfig &cfg)
+{
+    //"gdrive:backup (fast)"
+    QString conn_name = cfg.connection;
+    if (!cfg.remote_path.isEmpty())
+        conn_name += ":" + cfg.remote_path;
+    if (cfg.profile.isEmpty()) return conn_name;
+    return QString("%1 (%2)").arg(conn_name, cfg.profile);
 }
 
 void
 SettingsWindow::loadConnectionsFrame()
 {
-    foreach (QObject *child, m_wid_conns->children())
-        child->deleteLater();
-    QVBoxLayout *vbox = new QVBoxLayout;
-    delete m_wid_conns->layout();
-    m_wid_conns->setLayout(vbox);
+    QBoxLayout *vbox = qobject_cast<QBoxLayout*>(m_wid_conns->layout());
+
+    //Remotes from rclone.conf, parsed once (see RemoteCatalog)
+    //Each one is probed in the background, results are shown when available.
+    //Existing buttons are kept (matched by name), only new ones are created.
+    QList<RemoteInfo> remotes = RemoteCatalog::globalInstance()->remotes();
+    QSet<QString> names;
+    foreach (const RemoteInfo &remote, remotes)
+        names << remote.name;
+
+    //Remove buttons of remotes that are gone
+    foreach (QString name, m_conn_btns.keys())
+    {
+        if (names.contains(name)) continue;
+        QPointer<ItemButton> itm_conn = m_conn_btns.take(name);
+        if (!itm_conn) continue;
+        vbox->removeWidget(itm_conn);
+        itm_conn->deleteLater();
+    }
 
-    QStringList conn_names = getConnectionNames();
-    foreach (QString name, conn_names)
+    //Add new buttons, update and reorder the others
+    for (int i = 0, ii = remotes.size(); i < ii; i++)
     {
-        ItemButton *itm_conn = new ItemButton(name);
-        itm_conn->setSignalName(name);
-        connect(itm_conn, SIGNAL(clicked(const QString&)), SLOT(addMount(const QString&)));
-        vbox->addWidget(itm_conn);
-        vbox->addSpacing(5);
+        const RemoteInfo &remote = remotes[i];
+        QString name = remote.name;
+        RemoteHealth::globalInstance()->probe(name);
+        QPointer<ItemButton> itm_conn = m_conn_btns.value(name);
+        if (!itm_conn)
+        {
+            itm_conn = new ItemButton(name);
+            itm_conn->setSignalName(name);
+            m_conn_btns[name] = itm_conn;
+            connect(itm_conn, SIGNAL(clicked(const QString&)), SLOT(addMount(const QString&)));
+        }
+        itm_conn->setSubtitle(connectionSubtitle(remote));
+        if (vbox->indexOf(itm_conn) != i)
+        {
+            vbox->removeWidget(itm_conn);
+            vbox->insertWidget(i, itm_conn);
+        }
     }
-    if (conn_names.isEmpty())
+
+    if (remotes.isEmpty())
     {
-        ItemButton *itm_conn = new ItemButton(
-            tr("(No connections found.)"),
-            true);
-        itm_conn->setDisabled(true);
-        vbox->addWidget(itm_conn);
-        vbox->addSpacing(5);
+        //Not loaded yet: called again on RemoteCatalog::changed()
+        QString error = RemoteCatalog::globalInstance()->errorString();
+        if (!RemoteCatalog::globalInstance()->isLoaded())
+            m_btn_no_conns->setTitle(tr("(Loading connections...)"));
+        else
+            m_btn_no_conns->setTitle(
+                error.isEmpty() ? tr("(No connections found.)") : tr("(Cannot read connections: %1)").arg(error));
     }
+    m_btn_no_conns->setVisible(remotes.isEmpty());
+
+    filterItems(); //new buttons
+}
 
+void
+SettingsWindow::filterItems()
+{
+    //Mounts in the model, the (few) connection buttons are hidden
+    m_mdl_mounts->setFilter(m_txt_filter->text());
+    QString query = m_mdl_mounts->filter();
+    QHash<QString, QPointer<ItemButton>>::const_iterator it;
+    for (it = m_conn_btns.constBegin(); it != m_conn_btns.constEnd(); ++it)
+    {
+        if (!it.value()) continue;
+        it.value()->setVisible(ItemListModel::fuzzyMatch(it.key().toLower(), query));
+    }
 }
 
 void
@@ -171,17 +300,16 @@ SettingsWindow::renameItem()
         return;
     }
 
-    QVariantMap cfg = m_settings_new.mountConfig(mountpoint);
+    MountConfig cfg = getMountpointInfo(mountpoint);
 
-    QString cur_label = cfg["label"].toString();
+    QString cur_label = cfg.label;
     bool ok;
     QString text = QInputDialog::getText(this, tr("Edit mountpoint"),
         tr("Label for mountpoint at %1:").arg(mountpoint),
         QLineEdit::Normal, cur_label, &ok);
     if (!ok) return;
 
-    cfg["label"] = text;
-    m_settings_new.setMountConfig(cfg);
+    m_journal.setLabel(mountpoint, text);
 
     loadMountsFrame();
 }
@@ -199,18 +327,101 @@ SettingsWindow::removeItem()
         return;
     }
 
-    QVariantMap cfg = m_settings_new.mountConfig(mountpoint);
-
     QMessageBox::StandardButton btn = QMessageBox::question(this,
         tr("Edit mountpoint"),
         tr("Are you sure you want to remove this mountpoint?\n%1").arg(mountpoint));
     if (btn != QMessageBox::Yes) return;
 
-    m_settings_new.removeMountConfig(mountpoint);
+    m_journal.removeMount(mountpoint);
 
     loadMountsFrame();
 }
 
+void
+SettingsWindow::changeProfile()
+{
+    QAction *action = qobject_cast<QAction*>(QObject::sender());
+    QString mountpoint = action->data().toString();
+    if (mountpoint.isEmpty()) return;
+
+    //Tuning profiles (see benchmark), applied on next mount
+    QStringList items;
+    items << tr("(none)");
+    items << m_settings->profileNames();
+    QString cur_profile = getMountpointInfo(mountpoint).profile;
+    int cur_index = qMax(0, items.indexOf(cur_profile));
+    bool ok;
+    QString item = QInputDialog::getItem(this, tr("Edit mountpoint"),
+        tr("Tuning profile for mountpoint at %1:").arg(mountpoint),
+        items, cur_index, false, &ok);
+    if (!ok) return;
+    if (items.indexOf(item) == 0) item = "";
+    if (item == cur_profile) return;
+
+    m_journal.setProfile(mountpoint, item);
+
+    loadMountsFrame();
+}
+
+void
+SettingsWindow::changeRemotePath()
+{
+    QAction *action = qobject_cast<QAction*>(QObject::sender());
+    QString mountpoint = action->data().toString();
+    if (mountpoint.isEmpty()) return;
+    MountConfig cfg = getMountpointInfo(mountpoint);
+    if (cfg.connection.startsWith('/') || cfg.connection.contains(':'))
+    {
+        QMessageBox::information(this, tr("Edit mountpoint"),
+            tr("Only connections from the rclone config can be browsed."));
+        return;
+    }
+
+    //Browse remote, one directory level at a time (applied on next mount)
+    RemoteBrowser::setCacheTimeout(m_settings->variant("remote_browser_ttl", 300).toInt());
+    RemoteBrowser browser(cfg.connection, cfg.remote_path, this);
+    if (browser.exec() != QDialog::Accepted) return;
+    QString path = browser.selectedPath();
+    if (path == cfg.remote_path) return;
+
+    m_journal.setRemotePath(mountpoint, path);
+
+    loadMountsFrame();
+}
+
+void
+SettingsWindow::toggleAutoMount()
+{
+    QAction *action = qobject_cast<QAction*>(QObject::sender());
+    QString mountpoint = action->data().toString();
+    if (mountpoint.isEmpty()) return;
+
+    m_journal.setAutoMount(mountpoint, action->isChecked());
+
+    loadMountsFrame();
+}
+
+void
+SettingsWindow::healthChanged(const QString &remote)
+{
+    QPointer<ItemButton> button = m_conn_btns.value(remote);
+    if (!button) return;
+    button->setSubtitle(connectionSubtitle(RemoteCatalog::globalInstance()->remote(remote)));
+}
+
+QString
+SettingsWindow::connectionSubtitle(const RemoteInfo &remote)
+{
+    //"drive - ok, 120 ms", "s3 - authentication failed"
+    RemoteHealthInfo health = RemoteHealth::globalInstance()->health(remote.name);
+    QString text = remote.type;
+    if (health.status != RemoteHealthInfo::Unknown)
+        text = QString("%1 - %2").arg(text, health.summary());
+    else if (RemoteHealth::globalInstance()->isProbing(remote.name))
+        text = tr("%1 - checking...").arg(text);
+    return text;
+}
+
 void
 SettingsWindow::umountItem()
 {
@@ -224,9 +435,9 @@ SettingsWindow::umountItem()
             tr("This mountpoint is active. It will be stopped and unmounted now."),
             QMessageBox::Ok | QMessageBox::Cancel) != QMessageBox::Ok)
             return;
-        MountControl::fromMountpoint(mountpoint)->umount();
-        QMessageBox::information(this, tr("Mountpoint unmounted"),
-            tr("This mountpoint has been unmounted."));
+        MountControl::fromMountpoint(mountpoint)->requestUmount();
+        QMessageBox::information(this, tr("Mountpoint unmounting"),
+            tr("This mountpoint is being unmounted."));
     }
     else if (MountControl::fromMountpoint(mountpoint, true)->isExternallyMounted())
     {
@@ -234,9 +445,10 @@ SettingsWindow::umountItem()
             tr("This mountpoint is in use but not managed by this program. An attempt will now be made to unmount it."),
             QMessageBox::Ok | QMessageBox::Cancel) != QMessageBox::Ok)
             return;
-        if (!MountControl::fromMountpoint(mountpoint, true)->umountSystem())
+        MountControl::UmountResult result = MountControl::fromMountpoint(mountpoint, true)->umountSystem();
+        if (result != MountControl::UmountOk)
             QMessageBox::critical(this, tr("Mountpoint is in use"),
-                tr("Failed to unmount: %1").arg(mountpoint));
+                tr("Failed to unmount: %1\n%2").arg(mountpoint, MountControl::umountResultString(result)));
         else
             QMessageBox::information(this, tr("Mountpoint unmounted"),
                 tr("This mountpoint has been unmounted."));
@@ -248,46 +460,31 @@ SettingsWindow::umountItem()
     }
 }
 
-QString
-SettingsWindow::getRcloneConfigPath()
-{
-    //~/.config/rclone/rclone.conf
-    //TODO Settings, SettingsManager...
-    QString file_path;
-    file_path = QDir::home().absoluteFilePath(".config/rclone/rclone.conf");
-    return file_path;
-}
-
-QStringList
-SettingsWindow::getConnectionNames()
-{
-    QString file_path = getRcloneConfigPath();
-
-    QSettings rclone_config(file_path, QSettings::IniFormat); //TODO rclone config
-
-    return rclone_config.childGroups();
-}
-
 QStringList
 SettingsWindow::getMountpoints()
 {
     //Get configured mountpoints
     QStringList list;
-    foreach (const QVariantMap &cfg, m_settings_new.mountConfigList())
-        list.append(cfg.value("mountpoint").toString());
+    foreach (const MountConfig &cfg, mountConfigList())
+        list.append(cfg.mountpoint);
     return list;
 }
 
-QVariantMap
+MountConfig
 SettingsWindow::getMountpointInfo(const QDir &mountpoint)
 {
-    return m_settings_new.mountConfig(mountpoint.path());
+    foreach (const MountConfig &cfg, mountConfigList())
+    {
+        if (cfg.mountpoint == mountpoint.path())
+            return cfg;
+    }
+    return MountConfig();
 }
 
 void
 SettingsWindow::addMount(const QString &conn)
 {
-    if (!getMountpointInfo(conn).isEmpty()) return;
+    if (!getMountpointInfo(conn).mountpoint.isEmpty()) return;
 
     QString dir_path;
     do
@@ -301,7 +498,7 @@ SettingsWindow::addMount(const QString &conn)
         QDir dir(dir_path);
 
         //Check if selected dir is already configured
-        if (!getMountpointInfo(dir).isEmpty())
+        if (!getMountpointInfo(dir).mountpoint.isEmpty())
         {
             if (QMessageBox::critical(this, tr("Cannot add mountpoint"),
                 tr("This mountpoint is already defined."),
@@ -352,10 +549,10 @@ SettingsWindow::addMount(const QString &conn)
         tr("You have created a new mountpoint at %1 for the connection %2.").
         arg(dir_path, conn));
 
-    QVariantMap mount_conf;
-    mount_conf["connection"] = conn;
-    mount_conf["mountpoint"] = dir_path;
-    m_settings_new.setMountConfig(mount_conf);
+    MountConfig mount_conf;
+    mount_conf.connection = conn;
+    mount_conf.mountpoint = dir_path;
+    m_journal.addMount(mount_conf);
 
     loadMountsFrame();
 
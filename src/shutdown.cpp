@@ -0,0 +1,165 @@
+#include "shutdown.hpp"
+
+ShutdownCoordinator::ShutdownCoordinator(Policy policy, int deadline_ms, QWidget *parent)
+                   : QObject(parent),
+                     m_policy(policy),
+                     m_parent(parent),
+                     m_total(0),
+                     m_finished(false),
+                     m_forcing(false)
+{
+    m_tmr_poll.setInterval(500);
+    connect(&m_tmr_poll, SIGNAL(timeout()), SLOT(poll()));
+    m_tmr_deadline.setSingleShot(true);
+    m_tmr_deadline.setInterval(deadline_ms);
+    connect(&m_tmr_deadline, SIGNAL(timeout()), SLOT(deadlineReached()));
+}
+
+void
+ShutdownCoordinator::start()
+{
+    //Keep mounts: processes keep running, nothing to wait for
+    //(their output goes to log files, see MountControl::logFilePath())
+    if (m_policy == KeepMounts)
+    {
+        finish();
+        return;
+    }
+
+    foreach (QPointer<MountControl> mount, MountControl::activeControls())
+    {
+        m_pending[mount->mountpoint()] = mount;
+        connect(mount.data(), SIGNAL(umountedSignal(const QString&, int, const QByteArray&)), SLOT(mountFinished(const QString&)));
+    }
+    m_total = m_pending.size();
+    if (!m_total)
+    {
+        finish();
+        return;
+    }
+
+    //Progress dialog, cancel skips waiting (same as deadline)
+    m_dlg_progress = new QProgressDialog(tr("Unmounting..."), tr("&Force"), 0, m_total, m_parent);
+    m_dlg_progress->setWindowTitle(qApp->applicationName());
+    m_dlg_progress->setMinimumDuration(0);
+    m_dlg_progress->setAutoClose(false);
+    m_dlg_progress->setAutoReset(false);
+    connect(m_dlg_progress.data(), SIGNAL(canceled()), SLOT(deadlineReached()));
+    updateProgress();
+
+    m_tmr_deadline.start();
+    m_tmr_poll.start();
+    poll();
+}
+
+void
+ShutdownCoordinator::poll()
+{
+    //Ask every mount for pending uploads, all at once
+    //(one request per mount at a time, a hung rclone is not asked again)
+    foreach (QString mountpoint, m_pending.keys())
+    {
+        if (m_umounting.contains(mountpoint) || m_polling.contains(mountpoint)) continue;
+        QPointer<MountControl> mount = m_pending[mountpoint];
+        if (!mount)
+        {
+            mountFinished(mountpoint);
+            continue;
+        }
+        QNetworkReply *reply = mount->rcCall("vfs/stats");
+        if (!reply)
+        {
+            //No rc, nothing to wait for
+            m_umounting << mountpoint;
+            mount->requestUmount();
+            continue;
+        }
+        reply->setProperty("mountpoint", mountpoint);
+        connect(reply, SIGNAL(finished()), SLOT(statsReceived()));
+        m_polling << mountpoint;
+    }
+    updateProgress();
+}
+
+void
+ShutdownCoordinator::statsReceived()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (!reply) return;
+    reply->deleteLater();
+    QString mountpoint = reply->property("mountpoint").toString();
+    m_polling.remove(mountpoint);
+    QPointer<MountControl> mount = m_pending.value(mountpoint);
+    if (!mount || m_umounting.contains(mountpoint)) return;
+
+    //Wait while uploads are queued or in progress (error: don't wait)
+    if (reply->error() == QNetworkReply::NoError)
+    {
+        QJsonObject stats = QJsonDocument::fromJson(reply->readAll()).object();
+        QJsonObject cache = stats.value("diskCache").toObject();
+        int uploads = cache.value("uploadsInProgress").toInt() + cache.value("uploadsQueued").toInt();
+        if (uploads > 0) return;
+    }
+
+    m_umounting << mountpoint;
+    mount->requestUmount();
+    updateProgress();
+}
+
+void
+ShutdownCoordinator::mountFinished(const QString &mountpoint)
+{
+    m_pending.remove(mountpoint);
+    m_umounting.remove(mountpoint);
+    updateProgress();
+    if (m_pending.isEmpty())
+        finish();
+}
+
+void
+ShutdownCoordinator::deadlineReached()
+{
+    //Out of time, remaining mounts are detached and killed, all at once.
+    //Nothing blocks (hung mounts), each one reports back with mountFinished(),
+    //the rest is given up on after a grace period.
+    if (m_forcing) return;
+    m_forcing = true;
+    m_tmr_poll.stop();
+    m_tmr_deadline.stop();
+    foreach (QString mountpoint, m_pending.keys())
+    {
+        QPointer<MountControl> mount = m_pending.value(mountpoint);
+        if (!mount)
+        {
+            mountFinished(mountpoint);
+            continue;
+        }
+        m_umounting << mountpoint;
+        mount->forceUmount();
+    }
+    QTimer::singleShot(5000, this, SLOT(finish()));
+}
+
+void
+ShutdownCoordinator::updateProgress()
+{
+    if (!m_dlg_progress) return;
+    int uploading = m_pending.size() - m_umounting.size();
+    m_dlg_progress->setValue(m_total - m_pending.size());
+    m_dlg_progress->setLabelText(tr("Unmounting %1 of %2 mounts, %3 waiting for uploads...").
+        arg(m_pending.size()).arg(m_total).arg(uploading));
+}
+
+void
+ShutdownCoordinator::finish()
+{
+    if (m_finished) return;
+    m_finished = true;
+    m_tmr_poll.stop();
+    m_tmr_deadline.stop();
+    if (m_dlg_progress)
+        m_dlg_progress->deleteLater();
+
+    //Queued, so that the caller of start() is never re-entered
+    QTimer::singleShot(0, this, SIGNAL(finished()));
+}
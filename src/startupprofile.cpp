@@ -0,0 +1,73 @@
+#include "startupprofile.hpp"
+
+StartupProfile*
+StartupProfile::globalInstance()
+{
+    //Created before QApplication, so no parent
+    static StartupProfile *profile = new StartupProfile;
+    return profile;
+}
+
+StartupProfile::StartupProfile(QObject *parent)
+              : QObject(parent),
+                m_enabled(false)
+{
+    m_timer.start();
+}
+
+void
+StartupProfile::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+bool
+StartupProfile::isEnabled() const
+{
+    return m_enabled;
+}
+
+void
+StartupProfile::setBudget(const QString &phase, int budget_ms)
+{
+    m_budgets[phase] = budget_ms;
+}
+
+void
+StartupProfile::mark(const QString &phase)
+{
+    if (!m_enabled) return;
+    m_marks.append(qMakePair(phase, m_timer.elapsed()));
+}
+
+void
+StartupProfile::report()
+{
+    if (!m_enabled) return;
+
+    //phase, ms since start, ms since previous phase, budget
+    qInfo().noquote() << "Startup profile (ms):";
+    qint64 previous = 0;
+    bool over = false;
+    for (int i = 0, ii = m_marks.size(); i < ii; i++)
+    {
+        const QPair<QString, qint64> &mark = m_marks[i];
+        QString line = QString("  %1 %2 %3").
+            arg(mark.first, -24).arg(mark.second, 6).arg("+" + QString::number(mark.second - previous), 7);
+        if (m_budgets.contains(mark.first))
+        {
+            int budget = m_budgets[mark.first];
+            line += QString("  (budget %1)").arg(budget);
+            if (mark.second > budget)
+            {
+                line += " OVER BUDGET";
+                over = true;
+            }
+        }
+        qInfo().noquote() << line;
+        previous = mark.second;
+    }
+    if (over)
+        qWarning() << "Startup is over budget";
+    m_marks.clear();
+}